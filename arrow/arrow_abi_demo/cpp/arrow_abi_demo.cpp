@@ -1,13 +1,18 @@
 #include <arrow/api.h>
 #include <arrow/c/abi.h>
 #include <arrow/c/bridge.h>
+#include <arrow/util/byte_size.h>
 #include <jni_utils.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
 #define ASSERT(expr, msg)                                      \
     if (!(expr)) {                                             \
@@ -235,8 +240,197 @@ void stream_write_data_to_java_side() {
     if (stream.release) stream.release(&stream);
 }
 
-int main() {
+// Benchmark mode: sweep batch size, column count and type mix, and measure the exchange cost in both directions.
+// Only one batch is built per case on each side and handed out repeatedly, so that generation is not measured.
+struct BenchCase {
+    int64_t batch_rows;
+    int32_t num_columns;
+    std::string type_mix; // comma separated list of int/string/struct, assigned to columns round-robin
+};
+
+struct BenchResult {
+    int64_t rows = 0;
+    int64_t bytes = 0;
+    double seconds = 0;
+};
+
+static constexpr int64_t BENCH_TOTAL_ROWS = 4 * 1000 * 1000;
+static constexpr int64_t BENCH_MIN_BATCHES = 4;
+
+int64_t bench_num_batches(const BenchCase& bench_case) {
+    return std::max(BENCH_MIN_BATCHES, BENCH_TOTAL_ROWS / bench_case.batch_rows);
+}
+
+std::vector<std::string> split_type_mix(const std::string& type_mix) {
+    std::vector<std::string> types;
+    std::stringstream ss(type_mix);
+    std::string type;
+    while (std::getline(ss, type, ',')) {
+        types.push_back(type);
+    }
+    return types;
+}
+
+arrow::Result<std::shared_ptr<arrow::Array>> make_bench_int_array(int64_t num_rows) {
+    arrow::Int32Builder builder;
+    for (int64_t i = 0; i < num_rows; ++i) {
+        ARROW_RETURN_NOT_OK(builder.Append(static_cast<int32_t>(i)));
+    }
+    return builder.Finish();
+}
+
+arrow::Result<std::shared_ptr<arrow::Array>> make_bench_string_array(int64_t num_rows) {
+    arrow::StringBuilder builder;
+    for (int64_t i = 0; i < num_rows; ++i) {
+        ARROW_RETURN_NOT_OK(builder.Append("User_" + std::to_string(i)));
+    }
+    return builder.Finish();
+}
+
+// Must be kept consistent with ArrowBenchProvider on the java side. Every column gets its own buffers, like the
+// java vectors, since TotalBufferSize counts a buffer shared by several columns only once
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> make_bench_batch(const BenchCase& bench_case) {
+    const auto types = split_type_mix(bench_case.type_mix);
+    const auto person_type = arrow::struct_({arrow::field("name", arrow::utf8()), arrow::field("age", arrow::int32())});
+
+    arrow::FieldVector fields;
+    std::vector<std::shared_ptr<arrow::Array>> columns;
+    for (int32_t i = 0; i < bench_case.num_columns; ++i) {
+        const auto& type = types[i % types.size()];
+        const auto name = "col_" + std::to_string(i) + "_" + type;
+        if (type == "int") {
+            fields.push_back(arrow::field(name, arrow::int32()));
+            ARROW_ASSIGN_OR_RAISE(auto int_array, make_bench_int_array(bench_case.batch_rows));
+            columns.push_back(int_array);
+        } else if (type == "string") {
+            fields.push_back(arrow::field(name, arrow::utf8()));
+            ARROW_ASSIGN_OR_RAISE(auto string_array, make_bench_string_array(bench_case.batch_rows));
+            columns.push_back(string_array);
+        } else if (type == "struct") {
+            fields.push_back(arrow::field(name, person_type));
+            ARROW_ASSIGN_OR_RAISE(auto name_array, make_bench_string_array(bench_case.batch_rows));
+            ARROW_ASSIGN_OR_RAISE(auto age_array, make_bench_int_array(bench_case.batch_rows));
+            columns.push_back(std::make_shared<arrow::StructArray>(
+                    person_type, bench_case.batch_rows,
+                    std::vector<std::shared_ptr<arrow::Array>>{name_array, age_array}));
+        } else {
+            return arrow::Status::Invalid("Unsupported bench type: ", type);
+        }
+    }
+    return arrow::RecordBatch::Make(arrow::schema(fields), bench_case.batch_rows, columns);
+}
+
+BenchResult bench_read_data_from_java_side(const BenchCase& bench_case) {
+    BenchResult result;
+    ArrowArrayStream stream;
+    memset(&stream, 0, sizeof(ArrowArrayStream));
+
+    using namespace jni_utils;
+    auto* env = get_env();
+    AutoGlobalJobject jcls = find_class(env, "org/liuyehcf/ArrowBenchProvider");
+    auto mid = get_method(env, jcls, "generate", "(JIIILjava/lang/String;)V", true);
+    AutoLocalJobject jtype_mix = env->NewStringUTF(bench_case.type_mix.c_str());
+    invoke_static_method(env, jcls, &mid, &stream, static_cast<jint>(bench_case.batch_rows),
+                         static_cast<jint>(bench_num_batches(bench_case)), static_cast<jint>(bench_case.num_columns),
+                         static_cast<jstring>(jtype_mix));
+
+    auto maybe_reader = arrow::ImportRecordBatchReader(&stream);
+    ASSERT(maybe_reader.ok(), "Failed to import RecordBatchReader: " << maybe_reader.status().ToString());
+    auto reader = *maybe_reader;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<arrow::RecordBatch> batch;
+    while (true) {
+        auto status = reader->ReadNext(&batch);
+        ASSERT(status.ok(), "Failed to read: " << status.ToString());
+        if (!batch) {
+            break;
+        }
+        result.rows += batch->num_rows();
+        result.bytes += arrow::util::TotalBufferSize(*batch);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+BenchResult bench_write_data_to_java_side(const BenchCase& bench_case) {
+    class RepeatedRecordBatchReader : public arrow::RecordBatchReader {
+    public:
+        RepeatedRecordBatchReader(std::shared_ptr<arrow::RecordBatch> batch, int64_t total_batches)
+                : _batch(std::move(batch)), _total_batches(total_batches) {}
+
+        std::shared_ptr<arrow::Schema> schema() const override { return _batch->schema(); }
+
+        arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch>* batch) override {
+            *batch = _batch_index++ < _total_batches ? _batch : nullptr;
+            return arrow::Status::OK();
+        }
+
+    private:
+        const std::shared_ptr<arrow::RecordBatch> _batch;
+        const int64_t _total_batches;
+        int64_t _batch_index = 0;
+    };
+
+    BenchResult result;
+    auto maybe_batch = make_bench_batch(bench_case);
+    ASSERT(maybe_batch.ok(), "Failed to make bench batch: " << maybe_batch.status().ToString());
+    const int64_t num_batches = bench_num_batches(bench_case);
+    auto reader = std::make_shared<RepeatedRecordBatchReader>(*maybe_batch, num_batches);
+
+    ArrowArrayStream stream;
+    auto status = arrow::ExportRecordBatchReader(reader, &stream);
+    ASSERT(status.ok(), "Failed to export RecordBatchReader: " << status.ToString());
+
+    using namespace jni_utils;
+    auto* env = get_env();
+    AutoGlobalJobject jcls = find_class(env, "org/liuyehcf/ArrowStreamConsumer");
+    auto mid = get_method(env, jcls, "consumeSilently", "(J)J", true);
+
+    const auto start = std::chrono::steady_clock::now();
+    jvalue rows = invoke_static_method(env, jcls, &mid, &stream);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stream.release) stream.release(&stream);
+
+    result.rows = rows.j;
+    result.bytes = arrow::util::TotalBufferSize(**maybe_batch) * num_batches;
+    ASSERT(result.rows == bench_case.batch_rows * num_batches, "Unexpected row count: " << result.rows);
+    return result;
+}
+
+void print_bench_result(const char* direction, const BenchCase& bench_case, const BenchResult& result) {
+    std::cout << std::left << std::setw(10) << direction << std::right << std::setw(10) << bench_case.batch_rows
+              << std::setw(6) << bench_case.num_columns << "  " << std::left << std::setw(20) << bench_case.type_mix
+              << std::right << std::fixed << std::setprecision(2) << std::setw(14) << result.rows / result.seconds
+              << std::setw(14) << result.bytes / result.seconds / (1024 * 1024) << std::endl;
+}
+
+void run_benchmark() {
+    std::cout << "========================== benchmark ==========================" << std::endl;
+    const std::vector<int64_t> batch_rows_list = {1000, 10000, 100000, 1000000};
+    const std::vector<int32_t> num_columns_list = {1, 4, 16};
+    const std::vector<std::string> type_mix_list = {"int", "string", "struct", "int,string,struct"};
+
+    std::cout << std::left << std::setw(10) << "direction" << std::right << std::setw(10) << "batch" << std::setw(6)
+              << "cols" << "  " << std::left << std::setw(20) << "types" << std::right << std::setw(14) << "rows/s"
+              << std::setw(14) << "MB/s" << std::endl;
+    for (const auto batch_rows : batch_rows_list) {
+        for (const auto num_columns : num_columns_list) {
+            for (const auto& type_mix : type_mix_list) {
+                const BenchCase bench_case{batch_rows, num_columns, type_mix};
+                print_bench_result("java->cpp", bench_case, bench_read_data_from_java_side(bench_case));
+                print_bench_result("cpp->java", bench_case, bench_write_data_to_java_side(bench_case));
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
     init_jni_env();
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_benchmark();
+        return 0;
+    }
     read_data_from_java_side();
     batch_write_data_to_java_side();
     stream_write_data_to_java_side();
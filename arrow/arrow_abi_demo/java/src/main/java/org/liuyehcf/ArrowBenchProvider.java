@@ -0,0 +1,152 @@
+package org.liuyehcf;
+
+import org.apache.arrow.c.ArrowArrayStream;
+import org.apache.arrow.c.Data;
+import org.apache.arrow.memory.RootAllocator;
+import org.apache.arrow.vector.FieldVector;
+import org.apache.arrow.vector.IntVector;
+import org.apache.arrow.vector.VarCharVector;
+import org.apache.arrow.vector.VectorSchemaRoot;
+import org.apache.arrow.vector.VectorUnloader;
+import org.apache.arrow.vector.complex.StructVector;
+import org.apache.arrow.vector.ipc.ArrowReader;
+import org.apache.arrow.vector.ipc.message.ArrowRecordBatch;
+import org.apache.arrow.vector.types.pojo.ArrowType;
+import org.apache.arrow.vector.types.pojo.Field;
+import org.apache.arrow.vector.types.pojo.FieldType;
+import org.apache.arrow.vector.types.pojo.Schema;
+
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+/**
+ * Silent ArrowReader used by the benchmark mode of arrow_abi_demo. One batch is generated up front
+ * and re-loaded for every call of loadNextBatch, so that only the exchange cost is measured.
+ */
+public class ArrowBenchProvider extends ArrowReader {
+    private final Schema schema;
+    private final int batchRows;
+    private final int numBatches;
+
+    private VectorSchemaRoot templateRoot;
+    private ArrowRecordBatch templateBatch;
+    private int batchCount = 0;
+    private long bytesRead = 0;
+
+    private ArrowBenchProvider(int batchRows, int numBatches, int numColumns, String typeMix) {
+        super(new RootAllocator());
+        this.batchRows = batchRows;
+        this.numBatches = numBatches;
+        this.schema = createSchema(numColumns, typeMix.split(","));
+        prepareTemplate();
+    }
+
+    private static Schema createSchema(int numColumns, String[] types) {
+        List<Field> fields = new ArrayList<>();
+        for (int i = 0; i < numColumns; i++) {
+            String type = types[i % types.length];
+            String name = "col_" + i + "_" + type;
+            switch (type) {
+                case "int":
+                    fields.add(new Field(name, FieldType.nullable(new ArrowType.Int(32, true)), null));
+                    break;
+                case "string":
+                    fields.add(new Field(name, FieldType.nullable(ArrowType.Utf8.INSTANCE), null));
+                    break;
+                case "struct":
+                    fields.add(
+                            new Field(
+                                    name,
+                                    FieldType.nullable(ArrowType.Struct.INSTANCE),
+                                    Arrays.asList(
+                                            new Field(
+                                                    "name",
+                                                    FieldType.nullable(ArrowType.Utf8.INSTANCE),
+                                                    null),
+                                            new Field(
+                                                    "age",
+                                                    FieldType.nullable(new ArrowType.Int(32, true)),
+                                                    null))));
+                    break;
+                default:
+                    throw new IllegalArgumentException("Unsupported bench type: " + type);
+            }
+        }
+        return new Schema(fields);
+    }
+
+    private static void fillInt(IntVector vector, int rowNum) {
+        vector.allocateNew(rowNum);
+        for (int i = 0; i < rowNum; i++) {
+            vector.set(i, i);
+        }
+        vector.setValueCount(rowNum);
+    }
+
+    private static void fillString(VarCharVector vector, int rowNum) {
+        vector.allocateNew(rowNum);
+        for (int i = 0; i < rowNum; i++) {
+            vector.setSafe(i, ("User_" + i).getBytes(StandardCharsets.UTF_8));
+        }
+        vector.setValueCount(rowNum);
+    }
+
+    private void prepareTemplate() {
+        templateRoot = VectorSchemaRoot.create(schema, allocator);
+        for (FieldVector vector : templateRoot.getFieldVectors()) {
+            if (vector instanceof IntVector) {
+                fillInt((IntVector) vector, batchRows);
+            } else if (vector instanceof VarCharVector) {
+                fillString((VarCharVector) vector, batchRows);
+            } else if (vector instanceof StructVector) {
+                StructVector structVector = (StructVector) vector;
+                structVector.allocateNew();
+                fillString(structVector.getChild("name", VarCharVector.class), batchRows);
+                fillInt(structVector.getChild("age", IntVector.class), batchRows);
+                for (int i = 0; i < batchRows; i++) {
+                    structVector.setIndexDefined(i);
+                }
+                structVector.setValueCount(batchRows);
+            }
+        }
+        templateRoot.setRowCount(batchRows);
+        templateBatch = new VectorUnloader(templateRoot).getRecordBatch();
+    }
+
+    @Override
+    public boolean loadNextBatch() {
+        if (batchCount++ >= numBatches) {
+            return false;
+        }
+        loadRecordBatch(templateBatch);
+        bytesRead += templateBatch.computeBodyLength();
+        return true;
+    }
+
+    @Override
+    public long bytesRead() {
+        return bytesRead;
+    }
+
+    @Override
+    protected void closeReadSource() {
+        templateBatch.close();
+        templateRoot.close();
+        allocator.close();
+    }
+
+    @Override
+    protected Schema readSchema() {
+        return schema;
+    }
+
+    public static void generate(
+            long address, int batchRows, int numBatches, int numColumns, String typeMix) {
+        ArrowBenchProvider provider =
+                new ArrowBenchProvider(batchRows, numBatches, numColumns, typeMix);
+        ArrowArrayStream stream = ArrowArrayStream.wrap(address);
+        Data.exportArrayStream(provider.allocator, provider, stream);
+    }
+}
@@ -44,4 +44,18 @@ public class ArrowStreamConsumer {
         }
         System.out.println("[java] Step8: Close ArrowArrayStream");
     }
+
+    /** Drain the stream without printing anything, returns the total row count. */
+    public static long consumeSilently(long address) throws IOException {
+        long rowCount = 0;
+        try (ArrowArrayStream stream = ArrowArrayStream.wrap(address);
+                ArrowReader arrowReader = Data.importArrayStream(new RootAllocator(), stream);
+                VectorSchemaRoot root = arrowReader.getVectorSchemaRoot()) {
+            while (arrowReader.loadNextBatch()) {
+                rowCount += root.getRowCount();
+                root.clear();
+            }
+        }
+        return rowCount;
+    }
 }
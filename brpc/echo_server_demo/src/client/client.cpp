@@ -1,27 +1,391 @@
+#include <brpc/callback.h>
 #include <brpc/channel.h>
+#include <brpc/stream.h>
+#include <bthread/bthread.h>
+#include <butil/fast_rand.h>
+#include <butil/strings/string_number_conversions.h>
+#include <butil/time.h>
+#include <gflags/gflags.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "echo.pb.h"
+#include "latency_histogram.h"
+
+DEFINE_string(server, "127.0.0.1:8000",
+              "Address of the echo server, unix:<path> for a Unix domain socket, or a naming service url such as "
+              "list://127.0.0.1:8000,127.0.0.1:8001 to spread the calls over replicas with --load_balancer");
+DEFINE_string(load_balancer, "",
+              "Load balancer over the servers of a naming service url: rr, random, la (locality-aware, favours the "
+              "replicas with the lowest latency) or c_murmurhash (consistent hashing of a random request code)");
+DEFINE_string(connection_type, "single", "Connection type of the channel: single, pooled or short");
+DEFINE_int32(timeout_ms, 1000, "RPC timeout in milliseconds");
+DEFINE_int32(max_retry, 3, "Max retries of a failed RPC");
+DEFINE_int32(backup_request_ms, -1,
+             "Send a backup request, to another replica when the load balancer has one, if the response did not come "
+             "within this many milliseconds. The first response wins. -1 disables backup requests");
+DEFINE_bool(load_test, false, "Drive the server with concurrent callers instead of sending a single request");
+DEFINE_int32(concurrency, 8, "Number of concurrent callers in load test mode");
+DEFINE_int32(qps, 0,
+             "Open-loop target QPS shared by all callers, requests are sent on schedule whether or not the previous "
+             "ones returned. 0 runs closed-loop, every caller waits for its response before sending the next one");
+DEFINE_string(qps_sweep, "",
+              "Comma separated target QPS values, runs one open-loop load test per value to show how goodput and "
+              "latency evolve past the saturation point. Use --max_retry=0 so that rejections are not retried");
+DEFINE_int32(duration_s, 10, "Duration of the load test in seconds");
+DEFINE_int32(payload_size, 16, "Size in bytes of the message sent in load test mode");
+DEFINE_string(mode, "unary",
+              "RPC used by the load test: unary sends one message per Echo, batch sends batch_size messages per "
+              "EchoBatch, stream writes messages to one long-lived stream per caller as fast as flow control allows");
+DEFINE_bool(attachment, false,
+            "Send the payload as request attachment instead of protobuf field, the server echoes it back as "
+            "response attachment without copying it. Applies to unary mode and the single request");
+DEFINE_int32(batch_size, 64, "Number of messages per EchoBatch in batch mode");
+DEFINE_int32(stream_max_buf_size, 2 * 1024 * 1024,
+             "Max bytes written to a stream but not yet consumed by the server in stream mode");
+
+struct LoadStats {
+    LatencyHistogram latency;
+    std::atomic<int64_t> succeeded{0};
+    std::atomic<int64_t> failed{0};
+    // Failures broken down: shed by a concurrency limiter of the server (ELIMIT) or timed out
+    std::atomic<int64_t> rejected{0};
+    std::atomic<int64_t> timed_out{0};
+    // Calls for which a backup request was sent
+    std::atomic<int64_t> backups{0};
+    std::atomic<int64_t> inflight{0};
+    // Messages echoed back, a batch counts all of its messages
+    std::atomic<int64_t> messages{0};
+    std::atomic<int64_t> attachment_bytes{0};
+};
+
+struct EchoCall {
+    brpc::Controller cntl;
+    example::EchoResponse response;
+    example::EchoBatchResponse batch_response;
+    // Latency is measured from the time the request was due, so that a stalled server cannot hide its
+    // queueing delay by slowing the sender down (coordinated omission)
+    int64_t scheduled_us;
+    LoadStats* stats;
+};
+
+static void on_echo_done(EchoCall* call) {
+    LoadStats* stats = call->stats;
+    if (call->cntl.has_backup_request()) {
+        stats->backups.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (call->cntl.Failed()) {
+        stats->failed.fetch_add(1, std::memory_order_relaxed);
+        if (call->cntl.ErrorCode() == brpc::ELIMIT) {
+            stats->rejected.fetch_add(1, std::memory_order_relaxed);
+        } else if (call->cntl.ErrorCode() == brpc::ERPCTIMEDOUT) {
+            stats->timed_out.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        stats->latency.record(butil::gettimeofday_us() - call->scheduled_us);
+        stats->succeeded.fetch_add(1, std::memory_order_relaxed);
+        const int64_t messages = FLAGS_mode == "batch" ? call->batch_response.messages_size() : 1;
+        stats->messages.fetch_add(messages, std::memory_order_relaxed);
+        stats->attachment_bytes.fetch_add(call->cntl.response_attachment().size(), std::memory_order_relaxed);
+    }
+    delete call;
+    stats->inflight.fetch_sub(1, std::memory_order_release);
+}
+
+struct CallerContext {
+    example::EchoService_Stub* stub;
+    const example::EchoRequest* request;
+    const example::EchoBatchRequest* batch_request; // Set in batch mode
+    const butil::IOBuf* attachment;                 // Set in attachment mode
+    bool hash_requests;                             // Set with a consistent hashing load balancer
+    LoadStats* stats;
+    int64_t interval_us; // 0 for closed-loop
+    int64_t start_us;
+    int64_t deadline_us;
+};
+
+static void* run_caller(void* arg) {
+    auto* ctx = static_cast<CallerContext*>(arg);
+    int64_t next_us = ctx->start_us;
+    while (true) {
+        int64_t now_us = butil::gettimeofday_us();
+        if (ctx->interval_us > 0) {
+            if (next_us >= ctx->deadline_us) {
+                break;
+            }
+            if (next_us > now_us) {
+                bthread_usleep(next_us - now_us);
+            }
+        } else {
+            if (now_us >= ctx->deadline_us) {
+                break;
+            }
+            next_us = now_us;
+        }
+
+        auto* call = new EchoCall();
+        call->scheduled_us = next_us;
+        call->stats = ctx->stats;
+        if (ctx->hash_requests) {
+            // Stands for the key of the request, e.g. a user id, which decides its replica
+            call->cntl.set_request_code(butil::fast_rand());
+        }
+        if (ctx->attachment != nullptr) {
+            // Only references the blocks of the payload
+            call->cntl.request_attachment().append(*ctx->attachment);
+        }
+        ctx->stats->inflight.fetch_add(1, std::memory_order_relaxed);
+        google::protobuf::Closure* done = ctx->interval_us > 0 ? brpc::NewCallback(on_echo_done, call) : nullptr;
+        if (ctx->batch_request != nullptr) {
+            ctx->stub->EchoBatch(&call->cntl, ctx->batch_request, &call->batch_response, done);
+        } else {
+            ctx->stub->Echo(&call->cntl, ctx->request, &call->response, done);
+        }
+        if (done != nullptr) {
+            next_us += ctx->interval_us;
+        } else {
+            on_echo_done(call);
+        }
+    }
+    return nullptr;
+}
+
+// Counts the echoes of one stream, it must outlive the stream, i.e. until on_closed is called
+class StreamReceiver : public brpc::StreamInputHandler {
+public:
+    explicit StreamReceiver(LoadStats* stats) : _stats(stats) {}
+
+    int on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) override {
+        _received.fetch_add(size, std::memory_order_relaxed);
+        _stats->messages.fetch_add(size, std::memory_order_relaxed);
+        return 0;
+    }
+
+    void on_idle_timeout(brpc::StreamId id) override {}
+
+    void on_closed(brpc::StreamId id) override { _closed.store(true, std::memory_order_release); }
+
+    int64_t received() const { return _received.load(std::memory_order_relaxed); }
+
+    bool closed() const { return _closed.load(std::memory_order_acquire); }
+
+private:
+    LoadStats* _stats;
+    std::atomic<int64_t> _received{0};
+    std::atomic<bool> _closed{false};
+};
+
+static void* run_stream_caller(void* arg) {
+    auto* ctx = static_cast<CallerContext*>(arg);
+    StreamReceiver receiver(ctx->stats);
+
+    brpc::Controller cntl;
+    brpc::StreamOptions stream_options;
+    stream_options.handler = &receiver;
+    stream_options.max_buf_size = FLAGS_stream_max_buf_size;
+    brpc::StreamId stream_id;
+    if (brpc::StreamCreate(&stream_id, cntl, &stream_options) != 0) {
+        LOG(ERROR) << "Fail to create stream";
+        ctx->stats->failed.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    example::EchoResponse response;
+    ctx->stub->EchoStream(&cntl, ctx->request, &response, nullptr);
+    if (cntl.Failed()) {
+        LOG(ERROR) << "Fail to open stream, " << cntl.ErrorText();
+        ctx->stats->failed.fetch_add(1, std::memory_order_relaxed);
+        brpc::StreamClose(stream_id);
+        return nullptr;
+    }
+
+    butil::IOBuf payload;
+    payload.append(ctx->request->message());
+    int64_t sent = 0;
+    while (butil::gettimeofday_us() < ctx->deadline_us) {
+        // The payload blocks are shared by every write, nothing is copied
+        const int rc = brpc::StreamWrite(stream_id, payload);
+        if (rc == EAGAIN) {
+            const timespec due = butil::microseconds_to_timespec(ctx->deadline_us);
+            brpc::StreamWait(stream_id, &due);
+            continue;
+        }
+        if (rc != 0) {
+            LOG(ERROR) << "Fail to write to stream, " << berror(rc);
+            ctx->stats->failed.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        sent++;
+    }
+
+    // Give the echoes still in flight the RPC timeout to come back
+    const int64_t drain_deadline_us = butil::gettimeofday_us() + FLAGS_timeout_ms * 1000L;
+    while (receiver.received() < sent && butil::gettimeofday_us() < drain_deadline_us) {
+        bthread_usleep(1000);
+    }
+    // Like in the other modes, a message succeeded once its echo came back. The ones still missing are failures
+    const int64_t received = receiver.received();
+    ctx->stats->succeeded.fetch_add(received, std::memory_order_relaxed);
+    ctx->stats->failed.fetch_add(std::max<int64_t>(0, sent - received), std::memory_order_relaxed);
+    brpc::StreamClose(stream_id);
+    while (!receiver.closed()) {
+        bthread_usleep(1000);
+    }
+    return nullptr;
+}
+
+// User plus system CPU time consumed by this process so far
+static int64_t process_cpu_us() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000L + usage.ru_utime.tv_usec +
+           usage.ru_stime.tv_usec;
+}
+
+static int run_load_test(brpc::Channel* channel, int qps) {
+    example::EchoService_Stub stub(channel);
+    example::EchoRequest request;
+    butil::IOBuf attachment;
+    if (FLAGS_attachment) {
+        request.set_message("");
+        attachment.append(std::string(FLAGS_payload_size, 'x'));
+    } else {
+        request.set_message(std::string(FLAGS_payload_size, 'x'));
+    }
+    example::EchoBatchRequest batch_request;
+    for (int i = 0; i < FLAGS_batch_size; i++) {
+        batch_request.add_messages(request.message());
+    }
+    const bool stream_mode = FLAGS_mode == "stream";
+    if (FLAGS_mode != "unary" && FLAGS_mode != "batch" && !stream_mode) {
+        LOG(ERROR) << "Unknown mode " << FLAGS_mode;
+        return -1;
+    }
+
+    LoadStats stats;
+    const int64_t start_us = butil::gettimeofday_us();
+    const int64_t start_cpu_us = process_cpu_us();
+    const int64_t deadline_us = start_us + FLAGS_duration_s * 1000000L;
+    // Every caller sends at qps / concurrency, with its schedule shifted so that the sends are spread evenly
+    const int64_t interval_us =
+            qps > 0 ? std::max<int64_t>(1, int64_t(FLAGS_concurrency) * 1000000L / qps) : 0;
+
+    std::vector<CallerContext> contexts(FLAGS_concurrency);
+    std::vector<bthread_t> callers(FLAGS_concurrency);
+    for (int i = 0; i < FLAGS_concurrency; i++) {
+        auto& ctx = contexts[i];
+        ctx.stub = &stub;
+        ctx.request = &request;
+        ctx.batch_request = FLAGS_mode == "batch" ? &batch_request : nullptr;
+        ctx.attachment = FLAGS_attachment && FLAGS_mode == "unary" ? &attachment : nullptr;
+        ctx.hash_requests = FLAGS_load_balancer.compare(0, 2, "c_") == 0;
+        ctx.stats = &stats;
+        ctx.interval_us = interval_us;
+        ctx.start_us = start_us + interval_us * i / FLAGS_concurrency;
+        ctx.deadline_us = deadline_us;
+        if (bthread_start_background(&callers[i], nullptr, stream_mode ? run_stream_caller : run_caller, &ctx) != 0) {
+            LOG(ERROR) << "Fail to start caller " << i;
+            return -1;
+        }
+    }
+    for (bthread_t caller : callers) {
+        bthread_join(caller, nullptr);
+    }
+    // Wait for the responses of the open-loop requests still in flight, they are bounded by the timeout
+    while (stats.inflight.load(std::memory_order_acquire) > 0) {
+        bthread_usleep(1000);
+    }
+    const double elapsed_s = double(butil::gettimeofday_us() - start_us) / 1000000;
+    const int64_t cpu_us = process_cpu_us() - start_cpu_us;
+
+    LOG(INFO) << "Load test of " << FLAGS_mode << " mode against " << FLAGS_server
+              << (FLAGS_load_balancer.empty() ? "" : " balanced by " + FLAGS_load_balancer) << " over "
+              << FLAGS_connection_type << " connection, " << FLAGS_concurrency << " callers, "
+              << (qps > 0 && !stream_mode ? std::to_string(qps) : "closed-loop") << " target qps";
+    const int64_t succeeded = stats.succeeded.load();
+    // Successful calls per second, i.e. goodput, rejected and timed out calls are excluded
+    LOG(INFO) << "succeeded=" << succeeded << " failed=" << stats.failed.load()
+              << " (rejected=" << stats.rejected.load() << " timed_out=" << stats.timed_out.load() << ")"
+              << " backups=" << stats.backups.load()
+              << " qps=" << int64_t(double(succeeded) / elapsed_s)
+              << " messages/s=" << int64_t(double(stats.messages.load()) / elapsed_s);
+    // Compare the transports at the same load: the server side figure is process_cpu_usage on its /vars
+    const int64_t messages = std::max<int64_t>(1, stats.messages.load());
+    const double payload_mb = double(messages) * FLAGS_payload_size / 1048576;
+    LOG(INFO) << "client cpu=" << cpu_us / messages << "us/message"
+              << " " << int64_t(double(cpu_us) / std::max(payload_mb, 1e-6)) << "us/MB";
+    if (FLAGS_attachment) {
+        LOG(INFO) << "attachment throughput=" << int64_t(double(stats.attachment_bytes.load()) / elapsed_s / 1048576)
+                  << "MB/s";
+    }
+    if (stream_mode) {
+        // Stream writes are one-way, there is no per-message latency
+        return 0;
+    }
+    LOG(INFO) << "latency(us) avg=" << stats.latency.average() << " p50=" << stats.latency.percentile(0.5)
+              << " p99=" << stats.latency.percentile(0.99) << " p999=" << stats.latency.percentile(0.999)
+              << " max=" << stats.latency.max();
+    return 0;
+}
 
 int main(int argc, char* argv[]) {
+    google::ParseCommandLineFlags(&argc, &argv, true);
+
     brpc::Channel channel;
     brpc::ChannelOptions options;
     options.protocol = "baidu_std";
-    options.connection_type = "single";
-    options.timeout_ms = 1000;
-    options.max_retry = 3;
+    options.connection_type = FLAGS_connection_type;
+    options.timeout_ms = FLAGS_timeout_ms;
+    options.max_retry = FLAGS_max_retry;
+    options.backup_request_ms = FLAGS_backup_request_ms;
 
-    if (channel.Init("127.0.0.1:8000", &options) != 0) {
+    const char* load_balancer = FLAGS_load_balancer.empty() ? nullptr : FLAGS_load_balancer.c_str();
+    if (channel.Init(FLAGS_server.c_str(), load_balancer, &options) != 0) {
         LOG(ERROR) << "Fail to initialize channel";
         return -1;
     }
 
+    if (!FLAGS_qps_sweep.empty()) {
+        // Validate the whole sweep before running the first, possibly long, load test
+        std::istringstream sweep(FLAGS_qps_sweep);
+        std::string entry;
+        std::vector<int> qps_list;
+        while (std::getline(sweep, entry, ',')) {
+            int qps;
+            if (!butil::StringToInt(entry, &qps) || qps <= 0) {
+                LOG(ERROR) << "Invalid qps in --qps_sweep: '" << entry << "'";
+                return -1;
+            }
+            qps_list.push_back(qps);
+        }
+        for (int qps : qps_list) {
+            if (run_load_test(&channel, qps) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (FLAGS_load_test) {
+        return run_load_test(&channel, FLAGS_qps);
+    }
+
     example::EchoService_Stub stub(&channel);
 
     example::EchoRequest request;
     example::EchoResponse response;
     brpc::Controller cntl;
+    cntl.set_request_code(butil::fast_rand());
 
-    request.set_message("Hello BRPC!");
+    if (FLAGS_attachment) {
+        request.set_message("");
+        cntl.request_attachment().append("Hello BRPC!");
+    } else {
+        request.set_message("Hello BRPC!");
+    }
 
     stub.Echo(&cntl, &request, &response, nullptr);
 
@@ -31,5 +395,8 @@ int main(int argc, char* argv[]) {
     }
 
     LOG(INFO) << "Received response: " << response.message();
+    if (!cntl.response_attachment().empty()) {
+        LOG(INFO) << "Received attachment: " << cntl.response_attachment();
+    }
     return 0;
 }
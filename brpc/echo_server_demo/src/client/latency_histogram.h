@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free log-linear latency histogram: values below 16us are exact, larger values fall into one of 16
+// sub-buckets per power of two, so a reported percentile is at most 1/16 above the real one
+class LatencyHistogram {
+public:
+    void record(int64_t latency_us) {
+        latency_us = std::clamp<int64_t>(latency_us, 0, kMaxValue);
+        _buckets[bucket_index(latency_us)].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(latency_us, std::memory_order_relaxed);
+        int64_t max = _max.load(std::memory_order_relaxed);
+        while (latency_us > max && !_max.compare_exchange_weak(max, latency_us, std::memory_order_relaxed)) {
+        }
+    }
+
+    int64_t count() const { return _count.load(std::memory_order_relaxed); }
+
+    int64_t max() const { return _max.load(std::memory_order_relaxed); }
+
+    int64_t average() const {
+        const int64_t n = count();
+        return n == 0 ? 0 : _sum.load(std::memory_order_relaxed) / n;
+    }
+
+    // Upper bound of the bucket holding the given percentile (0 to 1), 0 if nothing was recorded
+    int64_t percentile(double ratio) const {
+        const int64_t n = count();
+        if (n == 0) {
+            return 0;
+        }
+        const auto rank = static_cast<int64_t>(ratio * static_cast<double>(n - 1));
+        int64_t seen = 0;
+        for (int i = 0; i < kNumBuckets; i++) {
+            seen += _buckets[i].load(std::memory_order_relaxed);
+            if (seen > rank) {
+                return std::min(bucket_upper_bound(i), max());
+            }
+        }
+        return max();
+    }
+
+private:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxExponent = 40;
+    static constexpr int64_t kMaxValue = (int64_t(1) << (kMaxExponent + 1)) - 1;
+    static constexpr int kNumBuckets = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+
+    static int bucket_index(int64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<int>(value);
+        }
+        const int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+        const int shift = exponent - kSubBucketBits;
+        const int sub_bucket = static_cast<int>(value >> shift) & (kSubBuckets - 1);
+        return (shift + 1) * kSubBuckets + sub_bucket;
+    }
+
+    static int64_t bucket_upper_bound(int index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+        const int shift = index / kSubBuckets - 1;
+        const int64_t sub_bucket = index % kSubBuckets;
+        return ((kSubBuckets + sub_bucket + 1) << shift) - 1;
+    }
+
+    std::atomic<int64_t> _buckets[kNumBuckets] = {};
+    std::atomic<int64_t> _count{0};
+    std::atomic<int64_t> _sum{0};
+    std::atomic<int64_t> _max{0};
+};
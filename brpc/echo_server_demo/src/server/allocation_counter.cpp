@@ -0,0 +1,95 @@
+#include "allocation_counter.h"
+
+#include <bvar/bvar.h>
+#include <gflags/gflags.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+DEFINE_bool(count_allocations, false, "Count the operator new calls of the server, exposed on /vars");
+
+namespace {
+
+constexpr int kNumShards = 64;
+
+// Threads are spread over cache line aligned counters, a single counter would serialize every allocation
+struct alignas(64) Shard {
+    std::atomic<int64_t> count{0};
+};
+
+Shard g_shards[kNumShards];
+std::atomic<int> g_next_shard{0};
+
+void count_allocation() {
+    if (!FLAGS_count_allocations) {
+        return;
+    }
+    // Plain thread_local int, initializing it does not allocate
+    thread_local int shard = -1;
+    if (shard < 0) {
+        shard = g_next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+    }
+    g_shards[shard].count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* allocate(size_t size) {
+    count_allocation();
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+int64_t get_allocation_count(void*) {
+    return allocation_count();
+}
+
+} // namespace
+
+int64_t allocation_count() {
+    int64_t count = 0;
+    for (const auto& shard : g_shards) {
+        count += shard.count.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void expose_allocation_counter() {
+    static bvar::PassiveStatus<int64_t> allocations("echo_server_allocations", get_allocation_count, nullptr);
+    static bvar::PerSecond<bvar::PassiveStatus<int64_t>> allocations_second("echo_server_allocations_second",
+                                                                            &allocations);
+}
+
+void* operator new(size_t size) {
+    void* ptr = allocate(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of operator new calls of the process since the start, only counted with --count_allocations
+int64_t allocation_count();
+
+// Expose the allocation count and rate on /vars as echo_server_allocations(_second)
+void expose_allocation_counter();
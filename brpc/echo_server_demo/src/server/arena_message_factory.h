@@ -0,0 +1,82 @@
+#pragma once
+
+#include <brpc/rpc_pb_message_factory.h>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/service.h>
+
+#include <memory>
+#include <vector>
+
+// Request and response of one call, allocated on an arena whose first block is embedded in this object.
+// Resetting the arena keeps that block, so a reused instance serves small messages without touching malloc.
+class ArenaRpcPBMessages : public brpc::RpcPBMessages {
+public:
+    ArenaRpcPBMessages() : _arena(arena_options(_initial_block, sizeof(_initial_block))) {}
+
+    google::protobuf::Message* Request() override { return _request; }
+
+    google::protobuf::Message* Response() override { return _response; }
+
+    void init(const google::protobuf::Service& service, const google::protobuf::MethodDescriptor& method) {
+        _request = service.GetRequestPrototype(&method).New(&_arena);
+        _response = service.GetResponsePrototype(&method).New(&_arena);
+    }
+
+    void reset() {
+        _request = nullptr;
+        _response = nullptr;
+        _arena.Reset();
+    }
+
+private:
+    static constexpr size_t kInitialBlockSize = 4096;
+
+    static google::protobuf::ArenaOptions arena_options(char* block, size_t size) {
+        google::protobuf::ArenaOptions options;
+        options.initial_block = block;
+        options.initial_block_size = size;
+        return options;
+    }
+
+    alignas(16) char _initial_block[kInitialBlockSize];
+    google::protobuf::Arena _arena;
+    google::protobuf::Message* _request = nullptr;
+    google::protobuf::Message* _response = nullptr;
+};
+
+// Hands out arena backed messages from a free list of the calling worker thread. Messages are returned to
+// the free list of whichever worker finishes the call, which keeps the lists balanced without any lock.
+class ArenaRpcPBMessageFactory : public brpc::RpcPBMessageFactory {
+public:
+    brpc::RpcPBMessages* Get(const google::protobuf::Service& service,
+                             const google::protobuf::MethodDescriptor& method) override {
+        auto& free_list = local_free_list();
+        std::unique_ptr<ArenaRpcPBMessages> messages;
+        if (free_list.empty()) {
+            messages = std::make_unique<ArenaRpcPBMessages>();
+        } else {
+            messages = std::move(free_list.back());
+            free_list.pop_back();
+        }
+        messages->init(service, method);
+        return messages.release();
+    }
+
+    void Return(brpc::RpcPBMessages* messages) override {
+        std::unique_ptr<ArenaRpcPBMessages> arena_messages(static_cast<ArenaRpcPBMessages*>(messages));
+        arena_messages->reset();
+        auto& free_list = local_free_list();
+        if (free_list.size() < kMaxFreeListSize) {
+            free_list.push_back(std::move(arena_messages));
+        }
+    }
+
+private:
+    // Bounds the memory kept by a worker after a burst of concurrent calls
+    static constexpr size_t kMaxFreeListSize = 128;
+
+    static std::vector<std::unique_ptr<ArenaRpcPBMessages>>& local_free_list() {
+        thread_local std::vector<std::unique_ptr<ArenaRpcPBMessages>> free_list;
+        return free_list;
+    }
+};
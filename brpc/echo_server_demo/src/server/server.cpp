@@ -1,17 +1,131 @@
 #include <brpc/server.h>
+#include <brpc/stream.h>
+#include <bthread/bthread.h>
+#include <butil/fast_rand.h>
+#include <butil/time.h>
+#include <gflags/gflags.h>
+#include <unistd.h>
 
+#include <sstream>
+#include <string>
+
+#include "allocation_counter.h"
+#include "arena_message_factory.h"
 #include "echo.pb.h"
 
+DECLARE_bool(count_allocations);
+DEFINE_bool(arena, false, "Allocate request and response messages on arenas reused by the worker threads");
+DEFINE_int32(max_concurrency, 0, "Max concurrent requests of the whole server, 0 for unlimited");
+DEFINE_string(method_max_concurrency, "",
+              "Comma separated <method>=<limit> list, e.g. Echo=auto,EchoBatch=64. The limit is a constant, "
+              "'auto' to adapt it to the measured latency and throughput, or 'timeout' to reject requests which "
+              "cannot finish within their client's timeout (see --timeout_cl_default_timeout_ms)");
+DEFINE_int32(port, 8000, "TCP port of the server, run replicas on distinct ports to serve one client from a list");
+DEFINE_string(unix_socket, "", "Listen on this Unix domain socket path instead of the TCP port");
+DEFINE_int32(echo_cpu_us, 0, "CPU time in microseconds burnt by every Echo, which makes the server saturate");
+DEFINE_double(slow_ratio, 0,
+              "Ratio of Echo calls delayed by --slow_ms, which makes this replica a source of tail latency");
+DEFINE_int32(slow_ms, 100, "Delay in milliseconds of the calls picked by --slow_ratio");
+
+// Writes every received message back to the stream it came from
+class EchoStreamHandler : public brpc::StreamInputHandler {
+public:
+    int on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) override {
+        for (size_t i = 0; i < size; i++) {
+            int rc;
+            // The stream is flow controlled, a client which does not read its echoes stalls this writer
+            while ((rc = brpc::StreamWrite(id, *messages[i])) == EAGAIN) {
+                brpc::StreamWait(id, nullptr);
+            }
+            if (rc != 0) {
+                LOG(WARNING) << "Fail to write to stream=" << id << ", " << berror(rc);
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    void on_idle_timeout(brpc::StreamId id) override {}
+
+    void on_closed(brpc::StreamId id) override { brpc::StreamClose(id); }
+};
+
 class EchoServiceImpl : public example::EchoService {
 public:
     void Echo(google::protobuf::RpcController* controller, const example::EchoRequest* request,
               example::EchoResponse* response, google::protobuf::Closure* done) override {
+        auto* cntl = static_cast<brpc::Controller*>(controller);
+        if (FLAGS_echo_cpu_us > 0) {
+            const int64_t until_us = butil::cpuwide_time_us() + FLAGS_echo_cpu_us;
+            while (butil::cpuwide_time_us() < until_us) {
+            }
+        }
+        if (FLAGS_slow_ratio > 0 && butil::fast_rand_double() < FLAGS_slow_ratio) {
+            // Only suspends this bthread, the worker keeps serving other calls meanwhile
+            bthread_usleep(FLAGS_slow_ms * 1000L);
+        }
         response->set_message("Echo: " + request->message());
+        // Large payloads come as attachment, whose blocks are handed over to the response as is:
+        // the body is neither copied nor encoded by protobuf
+        cntl->response_attachment().swap(cntl->request_attachment());
+        done->Run();
+    }
+
+    void EchoBatch(google::protobuf::RpcController* controller, const example::EchoBatchRequest* request,
+                   example::EchoBatchResponse* response, google::protobuf::Closure* done) override {
+        response->mutable_messages()->Reserve(request->messages_size());
+        for (const auto& message : request->messages()) {
+            response->add_messages("Echo: " + message);
+        }
         done->Run();
     }
+
+    void EchoStream(google::protobuf::RpcController* controller, const example::EchoRequest* request,
+                    example::EchoResponse* response, google::protobuf::Closure* done) override {
+        brpc::ClosureGuard done_guard(done);
+        auto* cntl = static_cast<brpc::Controller*>(controller);
+
+        brpc::StreamOptions stream_options;
+        stream_options.handler = &_stream_handler;
+        brpc::StreamId stream_id;
+        if (brpc::StreamAccept(&stream_id, *cntl, &stream_options) != 0) {
+            cntl->SetFailed("Fail to accept stream");
+            return;
+        }
+        response->set_message("Echo: " + request->message());
+    }
+
+private:
+    EchoStreamHandler _stream_handler;
 };
 
+// Install the limiters of --method_max_concurrency, requests above the limit fail fast with ELIMIT
+static int set_method_max_concurrency(brpc::Server* server, google::protobuf::Service* service) {
+    std::istringstream limits(FLAGS_method_max_concurrency);
+    std::string limit;
+    while (std::getline(limits, limit, ',')) {
+        const size_t pos = limit.find('=');
+        if (pos == std::string::npos) {
+            LOG(ERROR) << "Invalid method max concurrency: " << limit;
+            return -1;
+        }
+        const std::string method = limit.substr(0, pos);
+        if (service->GetDescriptor()->FindMethodByName(method) == nullptr) {
+            LOG(ERROR) << "Unknown method: " << method;
+            return -1;
+        }
+        server->MaxConcurrencyOf(service, method) = limit.substr(pos + 1);
+        LOG(INFO) << "Max concurrency of " << method << " is " << limit.substr(pos + 1);
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    if (FLAGS_count_allocations) {
+        expose_allocation_counter();
+    }
+
     brpc::Server server;
 
     EchoServiceImpl echo_service_impl;
@@ -20,9 +134,25 @@ int main(int argc, char* argv[]) {
         LOG(ERROR) << "Fail to add service";
         return -1;
     }
+    if (set_method_max_concurrency(&server, &echo_service_impl) != 0) {
+        return -1;
+    }
 
     brpc::ServerOptions options;
-    if (server.Start(8000, &options) != 0) {
+    options.max_concurrency = FLAGS_max_concurrency;
+    if (FLAGS_arena) {
+        // Owned by the server
+        options.rpc_pb_message_factory = new ArenaRpcPBMessageFactory();
+    }
+    int rc;
+    if (FLAGS_unix_socket.empty()) {
+        rc = server.Start(FLAGS_port, &options);
+    } else {
+        // A socket file left by a previous run would make bind fail
+        unlink(FLAGS_unix_socket.c_str());
+        rc = server.Start(("unix:" + FLAGS_unix_socket).c_str(), &options);
+    }
+    if (rc != 0) {
         LOG(ERROR) << "Fail to start server";
         return -1;
     }
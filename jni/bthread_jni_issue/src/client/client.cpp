@@ -1,8 +1,72 @@
 #include <brpc/channel.h>
+#include <bthread/bthread.h>
+#include <butil/time.h>
+#include <bvar/bvar.h>
+#include <gflags/gflags.h>
+#include <unistd.h>
+
+#include <vector>
 
 #include "echo.pb.h"
 
+DEFINE_bool(bench, false, "Drive the server with concurrent callers instead of sending a single request");
+DEFINE_int32(concurrency, 16, "Number of concurrent callers in bench mode");
+DEFINE_int32(duration_s, 30, "Duration of the bench in seconds");
+
+bvar::LatencyRecorder g_latency_recorder("client");
+bvar::Adder<int64_t> g_error_count("client_error_count");
+
+struct CallerContext {
+    example::EchoService_Stub* stub;
+    int64_t deadline_us;
+};
+
+static void* run_caller(void* arg) {
+    auto* ctx = static_cast<CallerContext*>(arg);
+    example::EchoRequest request;
+    request.set_message("Hello BRPC!");
+    while (butil::gettimeofday_us() < ctx->deadline_us) {
+        example::EchoResponse response;
+        brpc::Controller cntl;
+        ctx->stub->Echo(&cntl, &request, &response, nullptr);
+        if (cntl.Failed()) {
+            g_error_count << 1;
+            // Do not spin on a failing server
+            bthread_usleep(10000);
+        } else {
+            g_latency_recorder << cntl.latency_us();
+        }
+    }
+    return nullptr;
+}
+
+// Closed-loop load, the per-phase breakdown is read from the server's /vars/echo_jni_* meanwhile
+static int run_bench(brpc::Channel* channel) {
+    example::EchoService_Stub stub(channel);
+    CallerContext ctx = {&stub, butil::gettimeofday_us() + FLAGS_duration_s * 1000000L};
+    std::vector<bthread_t> callers(FLAGS_concurrency);
+    for (auto& caller : callers) {
+        if (bthread_start_background(&caller, nullptr, run_caller, &ctx) != 0) {
+            LOG(ERROR) << "Fail to start caller";
+            return -1;
+        }
+    }
+    while (butil::gettimeofday_us() < ctx.deadline_us) {
+        sleep(1);
+        LOG(INFO) << "qps=" << g_latency_recorder.qps(1) << " latency=" << g_latency_recorder.latency(1)
+                  << " p99=" << g_latency_recorder.latency_percentile(0.99) << " errors=" << g_error_count.get_value();
+    }
+    for (bthread_t caller : callers) {
+        bthread_join(caller, nullptr);
+    }
+    LOG(INFO) << "Average qps=" << g_latency_recorder.qps() << " latency=" << g_latency_recorder.latency()
+              << " p99=" << g_latency_recorder.latency_percentile(0.99) << " max=" << g_latency_recorder.max_latency();
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    google::ParseCommandLineFlags(&argc, &argv, true);
+
     brpc::Channel channel;
     brpc::ChannelOptions options;
     options.protocol = "baidu_std";
@@ -15,6 +79,10 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
+    if (FLAGS_bench) {
+        return run_bench(&channel);
+    }
+
     example::EchoService_Stub stub(&channel);
 
     example::EchoRequest request;
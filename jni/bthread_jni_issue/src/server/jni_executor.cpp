@@ -0,0 +1,51 @@
+#include "jni_executor.h"
+
+#include <jni_utils.h>
+
+JniExecutor::JniExecutor(int num_threads) {
+    for (int i = 0; i < num_threads; i++) {
+        _threads.emplace_back([this]() { run(); });
+    }
+}
+
+JniExecutor::~JniExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopped = true;
+    }
+    _cond.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void JniExecutor::submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+    _cond.notify_one();
+}
+
+void JniExecutor::run() {
+    // Attach once, the thread stays attached for its whole life
+    JNIEnv* env = jni_utils::get_env();
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this]() { return _stopped || !_tasks.empty(); });
+            // Pending tasks are drained before stopping, every submitted task owns a closure to run
+            if (_tasks.empty()) {
+                break;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+        task(env);
+    }
+    JavaVM* vm = nullptr;
+    if (env->GetJavaVM(&vm) == JNI_OK) {
+        vm->DetachCurrentThread();
+    }
+}
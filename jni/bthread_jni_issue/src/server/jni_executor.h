@@ -0,0 +1,35 @@
+#pragma once
+
+#include <jni.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of pthreads attached to the JVM once at startup. bthreads must not call into the JVM (a bthread
+// may migrate to another pthread in the middle of a JNI call), so they submit the JNI work here and return.
+class JniExecutor {
+public:
+    using Task = std::function<void(JNIEnv*)>;
+
+    explicit JniExecutor(int num_threads);
+    ~JniExecutor();
+
+    JniExecutor(const JniExecutor&) = delete;
+    JniExecutor& operator=(const JniExecutor&) = delete;
+
+    // Run the task on one of the attached threads, tasks are started in submission order
+    void submit(Task task);
+
+private:
+    void run();
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::deque<Task> _tasks;
+    bool _stopped = false;
+    std::vector<std::thread> _threads;
+};
@@ -1,28 +1,91 @@
 #include <brpc/server.h>
+#include <butil/time.h>
+#include <bvar/bvar.h>
+#include <gflags/gflags.h>
 #include <jni_utils.h>
 
+#include <memory>
+
 #include "echo.pb.h"
+#include "jni_executor.h"
+
+DEFINE_int32(jni_threads, 0,
+             "Number of JVM-attached pthreads running the JNI calls of Echo, which then completes asynchronously. "
+             "0 calls into the JVM from the thread running Echo");
+
+// Latency in microseconds of every phase of an Echo, exposed on /vars
+bvar::LatencyRecorder g_jni_queue_latency("echo_jni_queue");
+bvar::LatencyRecorder g_jni_attach_latency("echo_jni_attach");
+bvar::LatencyRecorder g_jni_lookup_latency("echo_jni_lookup");
+bvar::LatencyRecorder g_jni_call_latency("echo_jni_call");
+bvar::LatencyRecorder g_jni_string_latency("echo_jni_string");
+
+// Records the time spent in its scope
+class PhaseTimer {
+public:
+    explicit PhaseTimer(bvar::LatencyRecorder& recorder) : _recorder(recorder), _start_us(butil::cpuwide_time_us()) {}
+    ~PhaseTimer() { _recorder << butil::cpuwide_time_us() - _start_us; }
+
+private:
+    bvar::LatencyRecorder& _recorder;
+    int64_t _start_us;
+};
 
 class EchoServiceImpl : public example::EchoService {
 public:
+    explicit EchoServiceImpl(JniExecutor* executor) : _executor(executor) {}
+
     void Echo(google::protobuf::RpcController* controller, const example::EchoRequest* request,
               example::EchoResponse* response, google::protobuf::Closure* done) override {
-        response->set_message("Echo: " + request->message() + ", Java message: " + getMessageFromJava());
-        done->Run();
+        if (_executor == nullptr) {
+            JNIEnv* env;
+            {
+                // Attaches the worker thread to the JVM the first time it runs a call
+                PhaseTimer timer(g_jni_attach_latency);
+                env = jni_utils::get_env();
+            }
+            response->set_message("Echo: " + request->message() + ", Java message: " + getMessageFromJava(env));
+            done->Run();
+            return;
+        }
+        // The bthread returns right away, done is run by the executor once the Java call returned
+        auto* cntl = static_cast<brpc::Controller*>(controller);
+        const int64_t submit_us = butil::cpuwide_time_us();
+        // The executor threads were attached when they started, there is no attach phase here
+        _executor->submit([cntl, request, response, done, submit_us](JNIEnv* env) {
+            g_jni_queue_latency << butil::cpuwide_time_us() - submit_us;
+            brpc::ClosureGuard done_guard(done);
+            try {
+                response->set_message("Echo: " + request->message() + ", Java message: " + getMessageFromJava(env));
+            } catch (const std::exception& e) {
+                cntl->SetFailed("Fail to call Java, %s", e.what());
+            }
+        });
     }
 
 private:
-    inline static std::string getMessageFromJava() {
+    inline static std::string getMessageFromJava(JNIEnv* env) {
         using namespace jni_utils;
-        auto* env = get_env();
-        AutoGlobalJobject jcls = find_class(env, "SynchronizedServer");
-        auto mid = get_method(env, jcls, "getMessage", "()Ljava/lang/String;", true);
-        AutoLocalJobject jstr = static_cast<jstring>(invoke_static_method(env, jcls, &mid).l);
+        AutoGlobalJobject jcls;
+        Method mid;
+        {
+            PhaseTimer timer(g_jni_lookup_latency);
+            jcls = find_class(env, "SynchronizedServer");
+            mid = get_method(env, jcls, "getMessage", "()Ljava/lang/String;", true);
+        }
+        AutoLocalJobject jstr;
+        {
+            PhaseTimer timer(g_jni_call_latency);
+            jstr = static_cast<jstring>(invoke_static_method(env, jcls, &mid).l);
+        }
+        PhaseTimer timer(g_jni_string_latency);
         const char* chars = env->GetStringUTFChars(jstr, nullptr);
         std::string res = chars;
         env->ReleaseStringUTFChars(jstr, chars);
         return res;
     }
+
+    JniExecutor* _executor;
 };
 
 namespace brpc {
@@ -30,12 +93,17 @@ DECLARE_bool(usercode_in_pthread);
 }
 
 int main(int argc, char* argv[]) {
-    if (argc > 0) {
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    if (argc > 1) {
         brpc::FLAGS_usercode_in_pthread = (std::stoi(argv[1]) != 0);
     }
     brpc::Server server;
 
-    EchoServiceImpl echo_service_impl;
+    std::unique_ptr<JniExecutor> executor;
+    if (FLAGS_jni_threads > 0) {
+        executor = std::make_unique<JniExecutor>(FLAGS_jni_threads);
+    }
+    EchoServiceImpl echo_service_impl(executor.get());
 
     if (server.AddService(&echo_service_impl, brpc::SERVER_DOESNT_OWN_SERVICE) != 0) {
         LOG(ERROR) << "Fail to add service";
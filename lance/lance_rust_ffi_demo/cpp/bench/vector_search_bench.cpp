@@ -0,0 +1,154 @@
+#include <arrow/api.h>
+#include <arrow/c/bridge.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "lance_ffi.h"
+
+#define ASSERT_TRUE(expr, message)                                 \
+    if (!(expr)) {                                                 \
+        std::cerr << "Assertion failed: " << message << std::endl; \
+        return -1;                                                 \
+    }
+
+// Compare IVF_PQ search against brute force (use_index = false) on synthetic data
+// Usage: lance_vector_bench [num_rows] [num_queries] [k]
+static constexpr int32_t DIM = 128;
+static constexpr int64_t BATCH_ROWS = 10000;
+
+std::shared_ptr<arrow::Schema> make_schema() {
+    return arrow::schema({arrow::field("id", arrow::int32(), false),
+                          arrow::field("vector", arrow::fixed_size_list(arrow::float32(), DIM), false)});
+}
+
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> make_batch(const std::shared_ptr<arrow::Schema>& schema,
+                                                              const std::vector<float>& vectors, int64_t offset,
+                                                              int64_t length) {
+    arrow::Int32Builder id_builder;
+    arrow::FloatBuilder value_builder;
+    ARROW_RETURN_NOT_OK(id_builder.Reserve(length));
+    ARROW_RETURN_NOT_OK(value_builder.Reserve(length * DIM));
+    for (int64_t i = offset; i < offset + length; i++) {
+        ARROW_RETURN_NOT_OK(id_builder.Append(static_cast<int32_t>(i)));
+    }
+    ARROW_RETURN_NOT_OK(value_builder.AppendValues(vectors.data() + offset * DIM, length * DIM));
+    ARROW_ASSIGN_OR_RAISE(auto ids, id_builder.Finish());
+    ARROW_ASSIGN_OR_RAISE(auto values, value_builder.Finish());
+    ARROW_ASSIGN_OR_RAISE(auto vector_array, arrow::FixedSizeListArray::FromArrays(values, DIM));
+    return arrow::RecordBatch::Make(schema, length, {ids, vector_array});
+}
+
+// Run one query, returns the ids of the nearest neighbours, or an empty vector on error
+std::vector<int32_t> search(const LanceTable* table, const float* vector, int64_t k, bool use_index) {
+    const char* columns[] = {"id"};
+    struct LanceScanOptions scan_options = {columns, 1, nullptr, -1, 0, 0, 0};
+    struct LanceVectorQuery query = {"vector", vector, DIM, k, LANCE_METRIC_L2, 20, 0, false, use_index,
+                                     &scan_options};
+    struct ArrowArrayStream stream;
+    if (lance_table_vector_search(table, &query, &stream) != 0) {
+        return {};
+    }
+    auto reader = arrow::ImportRecordBatchReader(&stream).ValueOrDie();
+    std::vector<int32_t> ids;
+    std::shared_ptr<arrow::RecordBatch> batch;
+    while (reader->ReadNext(&batch).ok() && batch) {
+        auto id_array = std::static_pointer_cast<arrow::Int32Array>(batch->GetColumnByName("id"));
+        for (int64_t i = 0; i < id_array->length(); i++) {
+            ids.push_back(id_array->Value(i));
+        }
+    }
+    return ids;
+}
+
+int main(int argc, char* argv[]) {
+    const int64_t num_rows = argc > 1 ? std::stoll(argv[1]) : 100000;
+    const int64_t num_queries = argc > 2 ? std::stoll(argv[2]) : 100;
+    const int64_t k = argc > 3 ? std::stoll(argv[3]) : 10;
+
+    char read_link_res[1024];
+    const std::filesystem::path self = (std::string(read_link_res, readlink("/proc/self/exe", read_link_res, 1024)));
+    std::string dataset_path = (self.parent_path() / "lance_vector_bench").string();
+    std::filesystem::remove_all(dataset_path);
+
+    std::cout << "[cpp]: << Generating " << num_rows << " vectors of dim " << DIM << "..." << std::endl;
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> vectors(num_rows * DIM);
+    for (auto& value : vectors) {
+        value = dist(rng);
+    }
+
+    auto schema = make_schema();
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    for (int64_t offset = 0; offset < num_rows; offset += BATCH_ROWS) {
+        auto batch = make_batch(schema, vectors, offset, std::min(BATCH_ROWS, num_rows - offset));
+        ASSERT_TRUE(batch.ok(), "Failed to make batch: " + batch.status().ToString());
+        batches.push_back(*batch);
+    }
+    struct ArrowArrayStream write_stream;
+    auto export_result =
+            arrow::ExportRecordBatchReader(arrow::RecordBatchReader::Make(batches, schema).ValueOrDie(), &write_stream);
+    ASSERT_TRUE(export_result.ok(), "Failed to export RecordBatchReader");
+
+    ASSERT_TRUE(lance_init(dataset_path.c_str()) == 0, "Lance dataset initialization failed");
+    ASSERT_TRUE(lance_create_table_from_stream("vectors", &write_stream) == 0, "Table creation failed");
+    const LanceTable* table = lance_open_table("vectors");
+    ASSERT_TRUE(table != nullptr, "Failed to open table");
+
+    std::cout << "[cpp]: << Building IVF_PQ index..." << std::endl;
+    const int num_partitions = std::max(1, static_cast<int>(std::sqrt(static_cast<double>(num_rows))));
+    struct LanceVectorIndexOptions index_options = {"vector", LANCE_METRIC_L2, num_partitions, 16, 8, 50, true};
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(lance_table_create_vector_index(table, &index_options) == 0, "Failed to build vector index");
+    const double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Queries are dataset vectors with some noise
+    std::uniform_int_distribution<int64_t> row_dist(0, num_rows - 1);
+    std::vector<float> queries(num_queries * DIM);
+    for (int64_t q = 0; q < num_queries; q++) {
+        const int64_t row = row_dist(rng);
+        for (int32_t d = 0; d < DIM; d++) {
+            queries[q * DIM + d] = vectors[row * DIM + d] + 0.1f * dist(rng);
+        }
+    }
+
+    std::cout << "[cpp]: << Running " << num_queries << " queries with k = " << k << "..." << std::endl;
+    std::vector<std::vector<int32_t>> ground_truth(num_queries);
+    start = std::chrono::steady_clock::now();
+    for (int64_t q = 0; q < num_queries; q++) {
+        ground_truth[q] = search(table, &queries[q * DIM], k, false);
+        ASSERT_TRUE(!ground_truth[q].empty(), "Brute force search failed");
+    }
+    const double flat_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double recall_sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int64_t q = 0; q < num_queries; q++) {
+        auto ids = search(table, &queries[q * DIM], k, true);
+        ASSERT_TRUE(!ids.empty(), "ANN search failed");
+        std::set<int32_t> truth(ground_truth[q].begin(), ground_truth[q].end());
+        recall_sum += static_cast<double>(
+                              std::count_if(ids.begin(), ids.end(), [&](int32_t id) { return truth.count(id) > 0; })) /
+                      truth.size();
+    }
+    const double ann_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "[cpp]: Index build time: " << build_seconds << "s" << std::endl;
+    std::cout << "[cpp]: Brute force QPS: " << num_queries / flat_seconds << std::endl;
+    std::cout << "[cpp]: IVF_PQ QPS: " << num_queries / ann_seconds << std::endl;
+    std::cout << "[cpp]: IVF_PQ recall@" << k << ": " << recall_sum / num_queries << std::endl;
+
+    lance_close_table(table);
+    lance_cleanup();
+    return 0;
+}
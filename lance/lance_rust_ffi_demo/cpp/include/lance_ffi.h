@@ -2,25 +2,283 @@
 #define LANCE_DEMO_H
 
 #include <arrow/c/abi.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Initialize the Lance manager with database path
+// Opaque handle of an opened Lance table
+typedef struct LanceTable LanceTable;
+
+// Initialize the Lance manager with database path, every table is stored in <db_path>/<table_name>
 // Returns: 0 on success, negative on error
 int lance_init(const char* db_path);
 
-// Create a new Lance table
+// Runtime and I/O settings, zero fields keep the default
+typedef struct {
+    int32_t worker_threads;       // Async worker threads of the runtime, defaults to the number of cores
+    int32_t max_blocking_threads; // Upper bound of the blocking pool used by stream writes and local file reads
+    int32_t io_concurrency;       // Threads of the Lance I/O scheduler (LANCE_IO_THREADS)
+    int32_t cpu_threads;          // Threads of the Lance decoding runtime (LANCE_CPU_THREADS)
+    int64_t io_block_size;        // Size in bytes of a single read request to the dataset files
+    int32_t batch_readahead;      // Default batch readahead of scans which do not set prefetch_batches
+    // CPUs the threads of the FFI runtime are pinned to, bit i for CPU i, so only CPUs 0 to 63 can be set.
+    // The decoding and I/O threads of Lance are not pinned, cpu_threads and io_concurrency only size them
+    uint64_t cpu_affinity_mask;
+} LanceInitOptions;
+
+// Same as lance_init, with the runtime tuned by options (may be NULL). Only the first initialization counts,
+// the options cannot be changed afterwards. io_concurrency and cpu_threads are passed to Lance through the
+// environment, so this must be called before the process starts any other thread (JVM, engine pools), since
+// setting the environment races with concurrent getenv calls
+// Returns: 0 on success, negative on error, e.g. when cpu_affinity_mask sets no CPU available to the process
+int lance_init_with_options(const char* db_path, const LanceInitOptions* options);
+
+// Create a new Lance table with the demo schema (id: int32, name: utf8, value: int32)
 // Returns: 0 on success, negative on error
 int lance_create_table(const char* table_name);
 
+// Create a new empty Lance table with any schema, the schema is still owned (and released) by the caller
+// Returns: 0 on success, negative on error
+int lance_create_table_with_schema(const char* table_name, const struct ArrowSchema* schema);
+
+// Create a new Lance table with the schema and data of the given stream, which is consumed by this call
+// Returns: 0 on success, negative on error
+int lance_create_table_from_stream(const char* table_name, struct ArrowArrayStream* stream_addr);
+
+// Open an existing Lance table. Handles are thread safe: scans on the same table run concurrently,
+// and reads and writes on different tables never block each other
+// Returns: table handle on success, NULL on error. Must be released by lance_close_table
+const LanceTable* lance_open_table(const char* table_name);
+
+// Release a table handle returned by lance_open_table
+void lance_close_table(const LanceTable* table);
+
 // Write existing table with Arrow stream data using ArrowArrayStream
 int lance_write_arrow_stream(const char* table_name, struct ArrowArrayStream* stream_addr, bool is_overwrite);
 
-// Read data from a Lance table as ArrowArrayStream
+// Read data from a Lance table as ArrowArrayStream, batches are streamed as produced by the Lance scanner
 int lance_read_arrow_stream(const char* table_name, struct ArrowArrayStream* stream_addr);
 
+// Options pushed down to the Lance scanner
+struct LanceScanOptions {
+    // Columns to read, NULL means all columns
+    const char** columns;
+    size_t num_columns;
+    // SQL filter expression (e.g. "id > 3"), NULL means no filter
+    const char* filter;
+    // Max number of rows to return, non-positive means no limit
+    int64_t limit;
+    // Number of rows per returned batch, non-positive means the Lance default
+    int64_t batch_size;
+    // Number of batches decoded ahead of the consumer, non-positive means the default (2)
+    int64_t prefetch_batches;
+    // Number of fragments read concurrently, non-positive means the Lance default
+    int64_t io_parallelism;
+    // Append the uint64 "_rowid" column, whose values can be passed to lance_table_take_rows
+    bool with_row_id;
+    // Read this version instead of the latest one, non-positive means the latest version
+    int64_t version;
+    // Only read the rows appended after this version (up to version), non-positive means all rows.
+    // Fails if fragments were rewritten in between by an overwrite or a compaction
+    int64_t since_version;
+};
+
+// Read data from a Lance table as ArrowArrayStream, only the projected columns and the rows matching
+// the filter are read. options can be NULL, which is equivalent to lance_read_arrow_stream.
+// Batches are streamed: at most prefetch_batches batches are buffered ahead of the consumer, so memory
+// does not grow with the table size. get_next of the returned stream blocks until the next batch is ready
+int lance_read_arrow_stream_with_options(const char* table_name, const struct LanceScanOptions* options,
+                                         struct ArrowArrayStream* stream_addr);
+
+// Handle based variant of lance_write_arrow_stream
+int lance_table_write_arrow_stream(const LanceTable* table, struct ArrowArrayStream* stream_addr, bool is_overwrite);
+
+// Handle based variant of lance_read_arrow_stream_with_options
+int lance_table_read_arrow_stream(const LanceTable* table, const struct LanceScanOptions* options,
+                                  struct ArrowArrayStream* stream_addr);
+
+// Completion callback of the asynchronous operations. It is invoked on a Lance runtime thread,
+// so it must return quickly and must not call the synchronous Lance functions
+// status: 0 on success, non-zero on error
+typedef void (*LanceCompletionCallback)(void* user_data, uint64_t op_id, int status);
+
+// Asynchronous variant of lance_table_write_arrow_stream, returns immediately. The stream is owned by Lance
+// after this call, and the table handle may be closed before the operation completes
+// Returns: operation id (> 0), or 0 if the operation could not be started, in which case callback is never invoked
+uint64_t lance_table_write_arrow_stream_async(const LanceTable* table, struct ArrowArrayStream* stream_addr,
+                                              bool is_overwrite, LanceCompletionCallback callback, void* user_data);
+
+// Asynchronous variant of lance_table_read_arrow_stream, returns immediately. options is copied before
+// returning, while stream_addr must stay valid until the callback is invoked, and is only filled on success
+// Returns: operation id (> 0), or 0 if the operation could not be started, in which case callback is never invoked
+uint64_t lance_table_read_arrow_stream_async(const LanceTable* table, const struct LanceScanOptions* options,
+                                             struct ArrowArrayStream* stream_addr, LanceCompletionCallback callback,
+                                             void* user_data);
+
+// Opaque completion queue, backed by an eventfd which stays readable while there are completed operations,
+// so it can be registered in an event loop (poll/epoll)
+typedef struct LanceCompletionQueue LanceCompletionQueue;
+
+struct LanceCompletionEvent {
+    uint64_t op_id;
+    int status;
+};
+
+// Returns: completion queue on success, NULL on error
+LanceCompletionQueue* lance_completion_queue_new();
+
+// The eventfd of the queue, owned by the queue
+int lance_completion_queue_fd(const LanceCompletionQueue* queue);
+
+// Pass as callback, together with the queue as user_data, to deliver completions into the queue
+void lance_completion_queue_notify(void* queue, uint64_t op_id, int status);
+
+// Pop at most max_events completed operations
+// Returns: the number of events filled
+size_t lance_completion_queue_poll(const LanceCompletionQueue* queue, struct LanceCompletionEvent* events,
+                                   size_t max_events);
+
+// Destroy the queue, no operation may still be in flight on it
+void lance_completion_queue_free(LanceCompletionQueue* queue);
+
+// Distance metrics of vector indexes and queries
+#define LANCE_METRIC_L2 0
+#define LANCE_METRIC_COSINE 1
+#define LANCE_METRIC_DOT 2
+
+// IVF_PQ vector index parameters
+struct LanceVectorIndexOptions {
+    // Fixed size list of float32 column to index
+    const char* column;
+    // One of LANCE_METRIC_*
+    int metric;
+    // Number of IVF partitions, sqrt(num_rows) is a good start
+    int num_partitions;
+    // Number of PQ sub vectors, must divide the dimension
+    int num_sub_vectors;
+    // Bits per PQ code, non-positive means 8
+    int num_bits;
+    // Max KMeans iterations, non-positive means 50
+    int max_iterations;
+    // Replace the existing index on the column, if any
+    bool replace;
+};
+
+// Top-k nearest neighbour query
+struct LanceVectorQuery {
+    const char* column;
+    // Query vector of dim float32 values, copied before the call returns
+    const float* vector;
+    size_t dim;
+    int64_t k;
+    // One of LANCE_METRIC_*, should match the index
+    int metric;
+    // Number of IVF partitions to probe, non-positive means the Lance default
+    int nprobes;
+    // Re-rank k * refine_factor candidates with the original vectors, non-positive means no refine
+    int refine_factor;
+    // Apply the filter of scan before the vector search instead of after it
+    bool prefilter;
+    // Brute force search if false, which is useful as ground truth
+    bool use_index;
+    // Projection, filter and prefetch of the query, can be NULL. limit and batch_size are ignored
+    const struct LanceScanOptions* scan;
+};
+
+// Build an IVF_PQ vector index, this blocks writers and readers of the table until finished
+// Returns: 0 on success, non-zero on error
+int lance_table_create_vector_index(const LanceTable* table, const struct LanceVectorIndexOptions* options);
+
+// Top-k nearest neighbour search, results are streamed with an extra float32 column "_distance"
+// Returns: 0 on success, non-zero on error
+int lance_table_vector_search(const LanceTable* table, const struct LanceVectorQuery* query,
+                              struct ArrowArrayStream* stream_addr);
+
+// Scalar index types
+#define LANCE_SCALAR_INDEX_BTREE 0
+#define LANCE_SCALAR_INDEX_BITMAP 1
+
+// Build a scalar index on a column, filters on that column are then answered by the index
+// Returns: 0 on success, non-zero on error
+int lance_table_create_scalar_index(const LanceTable* table, const char* column, int index_type, bool replace);
+
+// Fetch rows by row id ("_rowid", see LanceScanOptions::with_row_id) as a single batch, in the order of row_ids.
+// columns can be NULL to read all columns. row_ids can be NULL only if num_row_ids is 0, which returns an empty
+// batch
+// Returns: 0 on success, non-zero on error
+int lance_table_take_rows(const LanceTable* table, const uint64_t* row_ids, size_t num_row_ids, const char** columns,
+                          size_t num_columns, struct ArrowArrayStream* stream_addr);
+
+// Fetch rows whose integer key column matches one of keys, using the scalar index of the column if there is one.
+// options can be NULL, or add a projection and an extra filter. keys can be NULL only if num_keys is 0, which
+// returns an empty stream
+// Returns: 0 on success, non-zero on error
+int lance_table_take_by_keys(const LanceTable* table, const char* column, const int64_t* keys, size_t num_keys,
+                             const struct LanceScanOptions* options, struct ArrowArrayStream* stream_addr);
+
+// Current version of the table, which includes every write done through this process
+// Returns: version on success, negative on error
+int64_t lance_table_version(const LanceTable* table);
+
+// Configure the thresholds of buffered writes: the buffer is committed once it holds max_rows rows or
+// max_bytes bytes, or its oldest batch waited max_delay_ms. Non-positive values keep the current setting,
+// initially 100000 rows, 64MB and 1000ms
+void lance_table_configure_write_buffer(const LanceTable* table, int64_t max_rows, int64_t max_bytes,
+                                        int64_t max_delay_ms);
+
+// Append the stream to the write buffer of the table instead of committing it right away, so that tiny
+// appends are coalesced into a few fragments. The stream is drained on the calling thread. Buffered rows are
+// not visible to readers until committed, and unbuffered writes may be committed before them. When the stream
+// fills the buffer, the buffer is flushed and the failure of this flush is returned, but the rows stay buffered
+// and must not be written again
+// Returns: 0 on success, non-zero on error
+int lance_table_buffered_write_arrow_stream(const LanceTable* table, struct ArrowArrayStream* stream_addr);
+
+// Commit the write buffer of the table, lance_cleanup flushes every table as well. If the commit fails, the rows
+// stay buffered and are committed by the next flush, explicit or in the background
+// Returns: 0 on success, non-zero on error
+int lance_table_flush(const LanceTable* table);
+
+// Merge small fragments into fragments of about target_rows_per_fragment rows (non-positive means 1M).
+// fragments_removed and fragments_added can be NULL
+// Returns: 0 on success, non-zero on error
+int lance_table_compact(const LanceTable* table, int64_t target_rows_per_fragment, int64_t* fragments_removed,
+                        int64_t* fragments_added);
+
+#define LANCE_LATENCY_BUCKETS 24
+
+// Latency histogram with power of two buckets: buckets[0] counts latencies below 1us, buckets[i] the ones in
+// [2^(i-1), 2^i) us, and the last bucket everything above
+typedef struct {
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+    uint64_t buckets[LANCE_LATENCY_BUCKETS];
+} LanceLatencyHistogram;
+
+// Process wide counters, cumulative since the start or the last lance_reset_metrics
+typedef struct {
+    LanceLatencyHistogram create_latency; // lance_create_table*
+    LanceLatencyHistogram write_latency;  // Stream writes, async writes and write buffer commits
+    LanceLatencyHistogram scan_latency;   // Scans, lookups and searches, until the stream is ready
+    uint64_t rows_written;                // Rows imported from C streams
+    uint64_t bytes_written;
+    uint64_t rows_read; // Rows exported to C streams, counted when the consumer pulls them
+    uint64_t bytes_read;
+    uint64_t fragments_created; // By writes and compaction
+    uint64_t read_requests;     // Object store requests (get, head, list)
+    uint64_t write_requests;    // Object store requests (put, delete, copy, rename)
+} LanceMetrics;
+
+// Copy the current metrics into metrics, it can be called from any thread at any time
+void lance_get_metrics(LanceMetrics* metrics);
+
+// Reset every counter and histogram to zero
+void lance_reset_metrics();
+
 // Cleanup resources
 void lance_cleanup();
 
@@ -0,0 +1,39 @@
+#ifndef PARALLEL_BATCH_BUILDER_H
+#define PARALLEL_BATCH_BUILDER_H
+
+#include <arrow/api.h>
+#include <arrow/util/thread_pool.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Build the columns of a RecordBatch in parallel and then assemble them.
+// Work is split into (column, row-range) tasks: wide batches are parallelized by column, while narrow batches
+// are additionally split into row ranges whose chunks are concatenated afterwards, so the output is identical
+// to building each column in a single pass.
+class ParallelBatchBuilder {
+public:
+    // Build the rows [offset, offset + length) of one column
+    using ColumnBuildFunc = std::function<arrow::Result<std::shared_ptr<arrow::Array>>(int64_t offset, int64_t length)>;
+
+    // Tasks run on the given executor, whose threads are reused across builds. Defaults to the Arrow CPU pool
+    ParallelBatchBuilder(std::shared_ptr<arrow::Schema> schema, int64_t num_rows,
+                         arrow::internal::Executor* executor = arrow::internal::GetCpuThreadPool(),
+                         int64_t min_chunk_rows = 64 * 1024);
+
+    void set_column(int column_index, ColumnBuildFunc func);
+
+    arrow::Result<std::shared_ptr<arrow::RecordBatch>> build();
+
+private:
+    int64_t chunks_per_column() const;
+
+    const std::shared_ptr<arrow::Schema> _schema;
+    const int64_t _num_rows;
+    arrow::internal::Executor* const _executor;
+    const int64_t _min_chunk_rows;
+    std::vector<ColumnBuildFunc> _funcs;
+};
+
+#endif // PARALLEL_BATCH_BUILDER_H
@@ -2,7 +2,9 @@
 #include <arrow/c/bridge.h>
 #include <arrow/io/api.h>
 #include <arrow/ipc/api.h>
+#include <poll.h>
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <iostream>
@@ -11,6 +13,7 @@
 #include <vector>
 
 #include "lance_ffi.h"
+#include "parallel_batch_builder.h"
 
 #define ASSERT_TRUE(expr, message)                                 \
     if (!(expr)) {                                                 \
@@ -70,40 +73,30 @@ private:
     size_t _current_batch = 0;
 };
 
+template <typename BuilderType, typename ValueType>
+ParallelBatchBuilder::ColumnBuildFunc make_column_build_func(const std::vector<ValueType>& values) {
+    return [&values](int64_t offset, int64_t length) -> arrow::Result<std::shared_ptr<arrow::Array>> {
+        BuilderType builder;
+        ARROW_RETURN_NOT_OK(builder.Reserve(length));
+        for (int64_t i = offset; i < offset + length; i++) {
+            ARROW_RETURN_NOT_OK(builder.Append(values[i]));
+        }
+        return builder.Finish();
+    };
+}
+
 int create_batch_arrow_stream(const std::shared_ptr<arrow::Schema>& schema, const std::vector<int32_t>& ids,
                               const std::vector<std::string>& names, const std::vector<int32_t>& values,
                               struct ArrowArrayStream* out_stream) {
-    // Create Arrow arrays
-    arrow::Int32Builder id_builder;
-    arrow::StringBuilder name_builder;
-    arrow::Int32Builder value_builder;
-
-    for (size_t i = 0; i < ids.size(); i++) {
-        auto status = id_builder.Append(ids[i]);
-        ASSERT_TRUE(status.ok(), "Failed to append id: " + status.ToString());
-
-        status = name_builder.Append(names[i]);
-        ASSERT_TRUE(status.ok(), "Failed to append name: " + status.ToString());
-
-        status = value_builder.Append(values[i]);
-        ASSERT_TRUE(status.ok(), "Failed to append value: " + status.ToString());
-    }
-
-    std::shared_ptr<arrow::Array> id_array;
-    std::shared_ptr<arrow::Array> name_array;
-    std::shared_ptr<arrow::Array> value_array;
-
-    auto status = id_builder.Finish(&id_array);
-    ASSERT_TRUE(status.ok(), "Failed to finish id array: " + status.ToString());
+    // Build columns in parallel, then assemble the record batch
+    ParallelBatchBuilder batch_builder(schema, ids.size());
+    batch_builder.set_column(0, make_column_build_func<arrow::Int32Builder>(ids));
+    batch_builder.set_column(1, make_column_build_func<arrow::StringBuilder>(names));
+    batch_builder.set_column(2, make_column_build_func<arrow::Int32Builder>(values));
 
-    status = name_builder.Finish(&name_array);
-    ASSERT_TRUE(status.ok(), "Failed to finish name array: " + status.ToString());
-
-    status = value_builder.Finish(&value_array);
-    ASSERT_TRUE(status.ok(), "Failed to finish value array: " + status.ToString());
-
-    // Create record batch
-    auto batch = arrow::RecordBatch::Make(schema, ids.size(), {id_array, name_array, value_array});
+    auto batch_result = batch_builder.build();
+    ASSERT_TRUE(batch_result.ok(), "Failed to build record batch: " + batch_result.status().ToString());
+    auto batch = batch_result.ValueOrDie();
 
     // Create a vector containing the single batch
     std::vector<std::shared_ptr<arrow::RecordBatch>> batches = {batch};
@@ -158,6 +151,64 @@ int display_arrow_stream(struct ArrowArrayStream* stream) {
     return 0;
 }
 
+int display_generic_arrow_stream(struct ArrowArrayStream* stream) {
+    auto reader_result = arrow::ImportRecordBatchReader(stream);
+    ASSERT_TRUE(reader_result.ok(), "Failed to import ArrowArrayStream");
+    auto reader = reader_result.ValueOrDie();
+
+    std::cout << "[cpp]:     Received Arrow stream with schema: " << reader->schema()->ToString(false) << std::endl;
+    while (true) {
+        auto batch_result = reader->Next();
+        ASSERT_TRUE(batch_result.ok(), "Failed to read next batch");
+
+        auto batch = batch_result.ValueOrDie();
+        if (!batch) break; // End of stream
+
+        std::cout << "[cpp]:         Batch with " << batch->num_rows() << " rows:" << std::endl;
+        std::cout << batch->ToString();
+    }
+    return 0;
+}
+
+// Upper bound in us of the bucket holding the given percentile, 0 if the histogram is empty
+uint64_t latency_percentile(const LanceLatencyHistogram& histogram, double percentile) {
+    const uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * histogram.count);
+    uint64_t seen = 0;
+    for (int i = 0; i < LANCE_LATENCY_BUCKETS; i++) {
+        seen += histogram.buckets[i];
+        if (histogram.count > 0 && seen > rank) {
+            return i == LANCE_LATENCY_BUCKETS - 1 ? histogram.max_us : std::min(uint64_t(1) << i, histogram.max_us);
+        }
+    }
+    return 0;
+}
+
+void print_latency(const char* name, const LanceLatencyHistogram& histogram) {
+    if (histogram.count == 0) {
+        return;
+    }
+    std::cout << "[cpp]:         " << name << ": count=" << histogram.count
+              << ", avg=" << histogram.sum_us / histogram.count << "us, p50<=" << latency_percentile(histogram, 50)
+              << "us, p99<=" << latency_percentile(histogram, 99) << "us, max=" << histogram.max_us << "us"
+              << std::endl;
+}
+
+// Print the metrics collected since the previous phase, then start over
+void print_metrics(const std::string& phase) {
+    LanceMetrics metrics;
+    lance_get_metrics(&metrics);
+    lance_reset_metrics();
+    std::cout << "[cpp]:     Metrics of phase '" << phase << "':" << std::endl;
+    print_latency("create", metrics.create_latency);
+    print_latency("write", metrics.write_latency);
+    print_latency("scan", metrics.scan_latency);
+    std::cout << "[cpp]:         rows written=" << metrics.rows_written << " (" << metrics.bytes_written
+              << " bytes), rows read=" << metrics.rows_read << " (" << metrics.bytes_read << " bytes)" << std::endl;
+    std::cout << "[cpp]:         fragments created=" << metrics.fragments_created
+              << ", read requests=" << metrics.read_requests << ", write requests=" << metrics.write_requests
+              << std::endl;
+}
+
 int main() {
     // Cleanup any existing dataset
     char read_link_res[1024];
@@ -170,12 +221,19 @@ int main() {
                                  arrow::field("value", arrow::int32())});
 
     std::cout << "[cpp]: << Initializing Lance dataset..." << std::endl;
-    int result = lance_init(dataset_path.c_str());
+    // A small runtime is plenty for the demo, the CPU affinity is left to the OS
+    LanceInitOptions init_options{};
+    init_options.worker_threads = 4;
+    init_options.max_blocking_threads = 16;
+    init_options.io_concurrency = 8;
+    init_options.batch_readahead = 4;
+    int result = lance_init_with_options(dataset_path.c_str(), &init_options);
     ASSERT_TRUE(result == 0, "Lance dataset initialization failed");
 
     std::cout << "[cpp]: << Creating table 'users'..." << std::endl;
     result = lance_create_table("users");
     ASSERT_TRUE(result == 0, "Table creation failed");
+    print_metrics("create");
 
     std::vector<int32_t> ids_1 = {1, 2, 3, 4, 5};
     std::vector<std::string> names_1 = {"Alice", "Bob", "Charlie", "Diana", "Eve"};
@@ -230,6 +288,155 @@ int main() {
     ASSERT_TRUE(result == 0, "Failed to read Arrow stream data");
     display_arrow_stream(&read_stream);
 
+    std::cout << "[cpp]: << Reading projected and filtered data as Arrow stream..." << std::endl;
+    const char* columns[] = {"id", "name"};
+    struct LanceScanOptions scan_options = {columns, 2, "id > 7", 2, 1, 4, 2};
+    result = lance_read_arrow_stream_with_options("users", &scan_options, &read_stream);
+    ASSERT_TRUE(result == 0, "Failed to read Arrow stream data with options");
+    display_generic_arrow_stream(&read_stream);
+    print_metrics("write and scan");
+
+    std::cout << "[cpp]: << Building scalar index and looking up rows by key..." << std::endl;
+    const LanceTable* users = lance_open_table("users");
+    ASSERT_TRUE(users != nullptr, "Failed to open table");
+    result = lance_table_create_scalar_index(users, "id", LANCE_SCALAR_INDEX_BTREE, true);
+    ASSERT_TRUE(result == 0, "Failed to build scalar index");
+    const int64_t keys[] = {2, 4};
+    struct LanceScanOptions take_options = {nullptr, 0, nullptr, -1, 0, 0, 0, true};
+    result = lance_table_take_by_keys(users, "id", keys, 2, &take_options, &read_stream);
+    ASSERT_TRUE(result == 0, "Failed to take rows by keys");
+    auto take_table = arrow::ImportRecordBatchReader(&read_stream).ValueOrDie()->ToTable().ValueOrDie();
+    std::cout << take_table->ToString();
+
+    std::cout << "[cpp]: << Looking up rows by row id..." << std::endl;
+    std::vector<uint64_t> row_ids;
+    for (const auto& chunk : take_table->GetColumnByName("_rowid")->chunks()) {
+        auto row_id_array = std::static_pointer_cast<arrow::UInt64Array>(chunk);
+        row_ids.insert(row_ids.end(), row_id_array->raw_values(), row_id_array->raw_values() + chunk->length());
+    }
+    result = lance_table_take_rows(users, row_ids.data(), row_ids.size(), nullptr, 0, &read_stream);
+    ASSERT_TRUE(result == 0, "Failed to take rows by row ids");
+    display_generic_arrow_stream(&read_stream);
+    print_metrics("index and lookup");
+
+    std::cout << "[cpp]: << Creating stream Arrow data and write to table through the write buffer..." << std::endl;
+    const int64_t version_before_append = lance_table_version(users);
+    ASSERT_TRUE(version_before_append > 0, "Failed to get table version");
+    lance_table_configure_write_buffer(users, 1000, 0, 2500);
+    result = create_customized_arrow_stream(schema, ids_1, names_1, values_1, &write_stream);
+    ASSERT_TRUE(result == 0, "Failed to create Arrow stream");
+    result = lance_table_buffered_write_arrow_stream(users, &write_stream);
+    ASSERT_TRUE(result == 0, "Failed to buffer Arrow stream data");
+    result = lance_table_flush(users);
+    ASSERT_TRUE(result == 0, "Failed to flush write buffer");
+
+    std::cout << "[cpp]: << Reading rows appended since version " << version_before_append << "..." << std::endl;
+    struct LanceScanOptions delta_options = {nullptr, 0, nullptr, -1, 0, 0, 0, false, 0, version_before_append};
+    result = lance_table_read_arrow_stream(users, &delta_options, &read_stream);
+    ASSERT_TRUE(result == 0, "Failed to read appended rows");
+    display_generic_arrow_stream(&read_stream);
+
+    std::cout << "[cpp]: << Reading version " << version_before_append << "..." << std::endl;
+    struct LanceScanOptions version_options = {nullptr, 0, nullptr, -1, 0, 0, 0, false, version_before_append, 0};
+    result = lance_table_read_arrow_stream(users, &version_options, &read_stream);
+    ASSERT_TRUE(result == 0, "Failed to read old version");
+    display_generic_arrow_stream(&read_stream);
+
+    std::cout << "[cpp]: << Compacting table..." << std::endl;
+    int64_t fragments_removed = 0;
+    int64_t fragments_added = 0;
+    result = lance_table_compact(users, 0, &fragments_removed, &fragments_added);
+    ASSERT_TRUE(result == 0, "Failed to compact table");
+    std::cout << "[cpp]:     " << fragments_removed << " fragments removed, " << fragments_added << " fragments added"
+              << std::endl;
+    print_metrics("buffered write, time travel and compaction");
+
+    std::cout << "[cpp]: << Reading data concurrently through a table handle..." << std::endl;
+    std::vector<std::thread> readers;
+    std::vector<int64_t> read_rows(4, 0);
+    for (size_t i = 0; i < read_rows.size(); i++) {
+        readers.emplace_back([users, &read_rows, i]() {
+            struct ArrowArrayStream stream;
+            if (lance_table_read_arrow_stream(users, nullptr, &stream) != 0) {
+                read_rows[i] = -1;
+                return;
+            }
+            auto reader = arrow::ImportRecordBatchReader(&stream).ValueOrDie();
+            std::shared_ptr<arrow::RecordBatch> batch;
+            while (reader->ReadNext(&batch).ok() && batch) {
+                read_rows[i] += batch->num_rows();
+            }
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    for (size_t i = 0; i < read_rows.size(); i++) {
+        std::cout << "[cpp]:     Reader " << i << " read " << read_rows[i] << " rows" << std::endl;
+        ASSERT_TRUE(read_rows[i] >= 0, "Failed to read Arrow stream data concurrently");
+    }
+    print_metrics("concurrent scan");
+
+    std::cout << "[cpp]: << Reading data asynchronously through a completion queue..." << std::endl;
+    LanceCompletionQueue* queue = lance_completion_queue_new();
+    ASSERT_TRUE(queue != nullptr, "Failed to create completion queue");
+    std::vector<struct ArrowArrayStream> async_streams(4);
+    std::vector<uint64_t> op_ids;
+    for (auto& stream : async_streams) {
+        uint64_t op_id =
+                lance_table_read_arrow_stream_async(users, nullptr, &stream, lance_completion_queue_notify, queue);
+        ASSERT_TRUE(op_id != 0, "Failed to start async read");
+        op_ids.push_back(op_id);
+    }
+    lance_close_table(users);
+    size_t completed = 0;
+    while (completed < op_ids.size()) {
+        // The calling thread is free until the eventfd becomes readable
+        struct pollfd pfd = {lance_completion_queue_fd(queue), POLLIN, 0};
+        ASSERT_TRUE(poll(&pfd, 1, -1) >= 0, "Failed to poll completion queue");
+        struct LanceCompletionEvent events[4];
+        size_t num_events = lance_completion_queue_poll(queue, events, 4);
+        for (size_t i = 0; i < num_events; i++) {
+            std::cout << "[cpp]:     Async read " << events[i].op_id << " completed with status " << events[i].status
+                      << std::endl;
+            ASSERT_TRUE(events[i].status == 0, "Failed to read Arrow stream data asynchronously");
+            auto index = std::find(op_ids.begin(), op_ids.end(), events[i].op_id) - op_ids.begin();
+            auto reader = arrow::ImportRecordBatchReader(&async_streams[index]).ValueOrDie();
+            ASSERT_TRUE(reader->ToTable().ok(), "Failed to read async Arrow stream");
+        }
+        completed += num_events;
+    }
+    lance_completion_queue_free(queue);
+    print_metrics("async scan");
+
+    std::cout << "[cpp]: << Creating table 'events' with a customized schema..." << std::endl;
+    auto events_schema = arrow::schema({arrow::field("ts", arrow::int64()), arrow::field("payload", arrow::utf8()),
+                                        arrow::field("score", arrow::float64())});
+    struct ArrowSchema c_schema;
+    ASSERT_TRUE(arrow::ExportSchema(*events_schema, &c_schema).ok(), "Failed to export schema");
+    result = lance_create_table_with_schema("events", &c_schema);
+    c_schema.release(&c_schema);
+    ASSERT_TRUE(result == 0, "Failed to create table with schema");
+    arrow::Int64Builder ts_builder;
+    arrow::StringBuilder payload_builder;
+    arrow::DoubleBuilder score_builder;
+    ASSERT_TRUE(ts_builder.AppendValues({1, 2}).ok(), "Failed to append ts");
+    ASSERT_TRUE(payload_builder.AppendValues({"login", "logout"}).ok(), "Failed to append payload");
+    ASSERT_TRUE(score_builder.AppendValues({0.5, 1.5}).ok(), "Failed to append score");
+    std::vector<std::shared_ptr<arrow::Array>> events_columns = {ts_builder.Finish().ValueOrDie(),
+                                                                 payload_builder.Finish().ValueOrDie(),
+                                                                 score_builder.Finish().ValueOrDie()};
+    auto events_batch = arrow::RecordBatch::Make(events_schema, 2, events_columns);
+    auto events_reader = arrow::RecordBatchReader::Make({events_batch}, events_schema).ValueOrDie();
+    auto export_status = arrow::ExportRecordBatchReader(events_reader, &write_stream);
+    ASSERT_TRUE(export_status.ok(), "Failed to export RecordBatchReader");
+    result = lance_write_arrow_stream("events", &write_stream, false);
+    ASSERT_TRUE(result == 0, "Failed to write Arrow stream data");
+    result = lance_read_arrow_stream("events", &read_stream);
+    ASSERT_TRUE(result == 0, "Failed to read Arrow stream data");
+    display_generic_arrow_stream(&read_stream);
+    print_metrics("customized schema");
+
     std::cout << "[cpp]: << Cleanup lance resources..." << std::endl;
     lance_cleanup();
 
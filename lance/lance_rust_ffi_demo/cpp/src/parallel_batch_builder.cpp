@@ -0,0 +1,75 @@
+#include "parallel_batch_builder.h"
+
+#include <arrow/util/parallel.h>
+
+#include <algorithm>
+
+ParallelBatchBuilder::ParallelBatchBuilder(std::shared_ptr<arrow::Schema> schema, int64_t num_rows,
+                                           arrow::internal::Executor* executor, int64_t min_chunk_rows)
+        : _schema(std::move(schema)),
+          _num_rows(num_rows),
+          _executor(executor),
+          _min_chunk_rows(std::max<int64_t>(1, min_chunk_rows)),
+          _funcs(_schema->num_fields()) {}
+
+void ParallelBatchBuilder::set_column(int column_index, ColumnBuildFunc func) {
+    _funcs[column_index] = std::move(func);
+}
+
+int64_t ParallelBatchBuilder::chunks_per_column() const {
+    const int64_t num_columns = _schema->num_fields();
+    if (num_columns == 0) {
+        return 1;
+    }
+    // Enough tasks to keep every thread busy, but never chunks smaller than _min_chunk_rows
+    const int64_t num_threads = std::max(1, _executor->GetCapacity());
+    const int64_t wanted = (num_threads + num_columns - 1) / num_columns;
+    const int64_t allowed = std::max<int64_t>(1, _num_rows / _min_chunk_rows);
+    return std::max<int64_t>(1, std::min(wanted, allowed));
+}
+
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> ParallelBatchBuilder::build() {
+    const int num_columns = _schema->num_fields();
+    for (int i = 0; i < num_columns; ++i) {
+        if (!_funcs[i]) {
+            return arrow::Status::Invalid("No build function for column ", i, " (", _schema->field(i)->name(), ")");
+        }
+    }
+
+    const int64_t num_chunks = chunks_per_column();
+    const int64_t chunk_rows = (_num_rows + num_chunks - 1) / std::max<int64_t>(1, num_chunks);
+    const int64_t num_tasks = num_columns * num_chunks;
+
+    std::vector<std::shared_ptr<arrow::Array>> chunks(num_tasks);
+    auto build_chunk = [&](int task) -> arrow::Status {
+        const int64_t column = task / num_chunks;
+        const int64_t offset = std::min(_num_rows, (task % num_chunks) * chunk_rows);
+        const int64_t length = std::min(chunk_rows, _num_rows - offset);
+        ARROW_ASSIGN_OR_RAISE(chunks[task], _funcs[column](offset, length));
+        return arrow::Status::OK();
+    };
+    if (num_tasks == 1) {
+        // Not worth a round trip through the executor
+        ARROW_RETURN_NOT_OK(build_chunk(0));
+    } else {
+        ARROW_RETURN_NOT_OK(arrow::internal::ParallelFor(static_cast<int>(num_tasks), build_chunk, _executor));
+    }
+
+    std::vector<std::shared_ptr<arrow::Array>> columns(num_columns);
+    for (int i = 0; i < num_columns; ++i) {
+        if (num_chunks == 1) {
+            columns[i] = chunks[i];
+            continue;
+        }
+        arrow::ArrayVector column_chunks(chunks.begin() + i * num_chunks, chunks.begin() + (i + 1) * num_chunks);
+        ARROW_ASSIGN_OR_RAISE(columns[i], arrow::Concatenate(column_chunks));
+    }
+    for (int i = 0; i < num_columns; ++i) {
+        if (columns[i]->length() != _num_rows || !columns[i]->type()->Equals(_schema->field(i)->type())) {
+            return arrow::Status::Invalid("Column ", i, " (", _schema->field(i)->name(), ") has unexpected length ",
+                                          columns[i]->length(), " or type ", columns[i]->type()->ToString());
+        }
+    }
+
+    return arrow::RecordBatch::Make(_schema, _num_rows, std::move(columns));
+}
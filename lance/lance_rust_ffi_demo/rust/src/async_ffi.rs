@@ -0,0 +1,268 @@
+use crate::ffi::{
+    default_scan_options, export_arrow_stream, import_arrow_stream, LanceScanOptions, LanceTable,
+    RUNTIME,
+};
+use crate::metrics::METRICS;
+use crate::prefetch_reader::{PrefetchRecordBatchReader, DEFAULT_PREFETCH_BATCHES};
+use arrow::ffi_stream::FFI_ArrowArrayStream;
+use std::collections::VecDeque;
+use std::os::raw::{c_int, c_void};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+use tokio::runtime::Handle;
+
+/// Completion callback, invoked on a runtime thread once the operation has finished
+pub type LanceCompletionCallback = extern "C" fn(user_data: *mut c_void, op_id: u64, status: c_int);
+
+static NEXT_OP_ID: AtomicU64 = AtomicU64::new(1);
+
+/// Raw pointer owned by the C caller, which keeps it valid until the completion callback is invoked
+struct SendPtr<T>(*mut T);
+
+unsafe impl<T> Send for SendPtr<T> {}
+
+impl<T> SendPtr<T> {
+    fn get(&self) -> *mut T {
+        self.0
+    }
+}
+
+struct Completion {
+    op_id: u64,
+    callback: LanceCompletionCallback,
+    user_data: SendPtr<c_void>,
+}
+
+impl Completion {
+    fn new(callback: LanceCompletionCallback, user_data: *mut c_void) -> Self {
+        Self {
+            op_id: NEXT_OP_ID.fetch_add(1, Ordering::Relaxed),
+            callback,
+            user_data: SendPtr(user_data),
+        }
+    }
+
+    fn complete(self, status: c_int) {
+        (self.callback)(self.user_data.get(), self.op_id, status);
+    }
+}
+
+/// Take another reference of a handle created by lance_open_table, so that the
+/// table outlives the operation even if the caller closes its handle meanwhile
+unsafe fn clone_table(table: *const LanceTable) -> Arc<LanceTable> {
+    Arc::increment_strong_count(table);
+    Arc::from_raw(table)
+}
+
+/// Asynchronous variant of lance_table_write_arrow_stream, returns the operation id, or 0 if
+/// the operation could not be started, in which case the callback is never invoked
+#[no_mangle]
+pub extern "C" fn lance_table_write_arrow_stream_async(
+    table: *const LanceTable,
+    stream_addr: *mut FFI_ArrowArrayStream,
+    is_overwrite: bool,
+    callback: LanceCompletionCallback,
+    user_data: *mut c_void,
+) -> u64 {
+    let timer = METRICS.write_latency.start();
+    let rt = RUNTIME.get().unwrap();
+
+    let batch_iter = match import_arrow_stream(stream_addr) {
+        Ok(reader) => reader,
+        Err(err) => {
+            println!(
+                "[rust]: Failed to create ArrowArrayStreamReader from FFI stream: {}",
+                err
+            );
+            return 0;
+        }
+    };
+
+    let table = unsafe { clone_table(table) };
+    let completion = Completion::new(callback, user_data);
+    let op_id = completion.op_id;
+
+    // Batches are pulled from the C stream synchronously, so the write is driven from a
+    // blocking thread instead of parking one of the runtime workers
+    rt.spawn_blocking(move || {
+        let status = Handle::current().block_on(async {
+            let mut manager_guard = table.manager.write().await;
+            match manager_guard
+                .write_from_stream(batch_iter, is_overwrite)
+                .await
+            {
+                Ok(_) => {
+                    println!(
+                        "[rust]: Arrow stream data written successfully in table '{}'",
+                        table.name
+                    );
+                    0
+                }
+                Err(e) => {
+                    println!("[rust]: Failed to write Arrow stream data: {}", e);
+                    1
+                }
+            }
+        });
+        // The latency covers the whole operation, up to but excluding the completion callback
+        drop(timer);
+        completion.complete(status);
+    });
+
+    op_id
+}
+
+/// Asynchronous variant of lance_table_read_arrow_stream, completes as soon as the scan is ready to
+/// stream, and stream_addr is only filled when the callback reports success. Returns the operation
+/// id, or 0 if the operation could not be started
+#[no_mangle]
+pub extern "C" fn lance_table_read_arrow_stream_async(
+    table: *const LanceTable,
+    options: *const LanceScanOptions,
+    stream_addr: *mut FFI_ArrowArrayStream,
+    callback: LanceCompletionCallback,
+    user_data: *mut c_void,
+) -> u64 {
+    let timer = METRICS.scan_latency.start();
+    let rt = RUNTIME.get().unwrap();
+
+    // Options are copied before returning, the caller may free them right away
+    let scan_options = if options.is_null() {
+        default_scan_options()
+    } else {
+        match unsafe { (*options).to_scan_options() } {
+            Ok(scan_options) => scan_options,
+            Err(e) => {
+                println!("[rust]: Invalid scan options: {}", e);
+                return 0;
+            }
+        }
+    };
+
+    let table = unsafe { clone_table(table) };
+    let stream = SendPtr(stream_addr);
+    let completion = Completion::new(callback, user_data);
+    let op_id = completion.op_id;
+
+    rt.spawn(async move {
+        let scan_result = {
+            let manager_guard = table.manager.read().await;
+            manager_guard.scan_stream(&scan_options).await
+        };
+        let status = match scan_result {
+            Ok((schema, batch_stream)) => {
+                let prefetch = scan_options
+                    .batch_readahead
+                    .unwrap_or(DEFAULT_PREFETCH_BATCHES);
+                let reader = PrefetchRecordBatchReader::spawn(rt, schema, batch_stream, prefetch);
+                export_arrow_stream(reader, stream.get());
+                println!(
+                    "[rust]: Start streaming data from table '{}' as Arrow stream",
+                    table.name
+                );
+                0
+            }
+            Err(e) => {
+                println!("[rust]: Failed to read data: {}", e);
+                1
+            }
+        };
+        drop(timer);
+        completion.complete(status);
+    });
+
+    op_id
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LanceCompletionEvent {
+    pub op_id: u64,
+    pub status: c_int,
+}
+
+/// Completion queue backed by an eventfd, which is readable as long as the queue is not empty.
+/// Events and the eventfd counter are only changed under the same lock to keep them consistent.
+pub struct LanceCompletionQueue {
+    fd: c_int,
+    events: Mutex<VecDeque<LanceCompletionEvent>>,
+}
+
+/// Create a completion queue, NULL on error
+#[no_mangle]
+pub extern "C" fn lance_completion_queue_new() -> *mut LanceCompletionQueue {
+    let fd = unsafe { libc::eventfd(0, libc::EFD_NONBLOCK | libc::EFD_CLOEXEC) };
+    if fd < 0 {
+        println!(
+            "[rust]: Failed to create eventfd: {}",
+            std::io::Error::last_os_error()
+        );
+        return std::ptr::null_mut();
+    }
+    Box::into_raw(Box::new(LanceCompletionQueue {
+        fd,
+        events: Mutex::new(VecDeque::new()),
+    }))
+}
+
+/// The eventfd to be registered in the caller's event loop
+#[no_mangle]
+pub extern "C" fn lance_completion_queue_fd(queue: *const LanceCompletionQueue) -> c_int {
+    unsafe { (*queue).fd }
+}
+
+/// A LanceCompletionCallback which pushes the event into the queue passed as user_data
+#[no_mangle]
+pub extern "C" fn lance_completion_queue_notify(user_data: *mut c_void, op_id: u64, status: c_int) {
+    let queue = unsafe { &*(user_data as *const LanceCompletionQueue) };
+    let mut events = queue.events.lock().unwrap();
+    events.push_back(LanceCompletionEvent { op_id, status });
+    let one: u64 = 1;
+    unsafe {
+        libc::write(
+            queue.fd,
+            &one as *const u64 as *const c_void,
+            std::mem::size_of::<u64>(),
+        );
+    }
+}
+
+/// Pop at most max_events finished operations, returns the number of events filled
+#[no_mangle]
+pub extern "C" fn lance_completion_queue_poll(
+    queue: *const LanceCompletionQueue,
+    events: *mut LanceCompletionEvent,
+    max_events: usize,
+) -> usize {
+    let queue = unsafe { &*queue };
+    let mut pending = queue.events.lock().unwrap();
+    let count = max_events.min(pending.len());
+    for i in 0..count {
+        unsafe {
+            *events.add(i) = pending.pop_front().unwrap();
+        }
+    }
+    if pending.is_empty() {
+        // Reset the counter, the fd is no longer readable
+        let mut counter: u64 = 0;
+        unsafe {
+            libc::read(
+                queue.fd,
+                &mut counter as *mut u64 as *mut c_void,
+                std::mem::size_of::<u64>(),
+            );
+        }
+    }
+    count
+}
+
+/// Destroy a completion queue, no operation may be in flight on it anymore
+#[no_mangle]
+pub extern "C" fn lance_completion_queue_free(queue: *mut LanceCompletionQueue) {
+    if !queue.is_null() {
+        let queue = unsafe { Box::from_raw(queue) };
+        unsafe {
+            libc::close(queue.fd);
+        }
+    }
+}
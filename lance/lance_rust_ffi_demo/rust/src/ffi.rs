@@ -1,40 +1,278 @@
-use crate::{LanceTableManager, SampleData};
+use crate::metrics::{record_batch, CountingReader, Direction, METRICS};
+use crate::prefetch_reader::{PrefetchRecordBatchReader, DEFAULT_PREFETCH_BATCHES};
+use crate::write_buffer::{WriteBuffer, WriteBufferOptions};
+use crate::{create_sample_schema, LanceTableManager, ScanOptions};
 use arrow::{
-    datatypes::SchemaRef,
+    datatypes::{Schema, SchemaRef},
     error::ArrowError,
+    ffi::FFI_ArrowSchema,
     ffi_stream::FFI_ArrowArrayStream,
-    record_batch::{RecordBatchIterator, RecordBatchReader},
+    record_batch::RecordBatchReader,
 };
+use std::collections::HashMap;
 use std::ffi::CStr;
 use std::os::raw::{c_char, c_int};
-use std::sync::{Mutex, OnceLock};
+use std::path::Path;
+use std::sync::{Arc, Mutex, OnceLock, Weak};
+use std::time::Duration;
 use tokio::runtime::Runtime;
+use tokio::sync::RwLock;
 
 // Global runtime for async operations
-static RUNTIME: OnceLock<Runtime> = OnceLock::new();
-static MANAGER: OnceLock<Mutex<LanceTableManager>> = OnceLock::new();
+pub(crate) static RUNTIME: OnceLock<Runtime> = OnceLock::new();
+// Root directory, every table lives in its own sub directory
+static DB_PATH: OnceLock<String> = OnceLock::new();
+// Opened tables by name, the registry lock is only held for lookups
+static TABLES: OnceLock<Mutex<HashMap<String, Arc<LanceTable>>>> = OnceLock::new();
+
+/// Opaque table handle given out to C. Scans take the read lock, so they run concurrently with each
+/// other; appends and overwrites take the write lock of this table only.
+pub struct LanceTable {
+    pub(crate) name: String,
+    pub(crate) manager: RwLock<LanceTableManager>,
+    pub(crate) write_buffer: Mutex<WriteBuffer>,
+}
+
+// How often buffered writes are checked against their max delay
+const WRITE_BUFFER_CHECK_INTERVAL: Duration = Duration::from_millis(50);
+
+/// Commit all buffered writes of the table as one append, returns the number of rows committed.
+/// The manager lock is held until the committed batches leave the buffer, so concurrent flushes commit
+/// batches in the order they were buffered, and never twice. If the commit fails, the batches stay
+/// buffered for the next flush.
+pub(crate) async fn flush_write_buffer(table: &LanceTable) -> anyhow::Result<usize> {
+    let mut manager_guard = table.manager.write().await;
+    let snapshot = table.write_buffer.lock().unwrap().snapshot();
+    match snapshot {
+        Some((schema, batches)) => {
+            let _timer = METRICS.write_latency.start();
+            let num_batches = batches.len();
+            let rows = batches.iter().map(|batch| batch.num_rows()).sum();
+            manager_guard.append_batches(schema, batches).await?;
+            table.write_buffer.lock().unwrap().consume(num_batches);
+            Ok(rows)
+        }
+        None => Ok(0),
+    }
+}
+
+/// Background task committing buffered writes which waited longer than their max delay
+fn spawn_write_buffer_flusher(rt: &Runtime, table: Weak<LanceTable>) {
+    rt.spawn(async move {
+        let mut interval = tokio::time::interval(WRITE_BUFFER_CHECK_INTERVAL);
+        loop {
+            interval.tick().await;
+            let table = match table.upgrade() {
+                Some(table) => table,
+                None => break,
+            };
+            let expired = table.write_buffer.lock().unwrap().is_expired();
+            if expired {
+                if let Err(e) = flush_write_buffer(&table).await {
+                    println!(
+                        "[rust]: Failed to flush write buffer of table '{}': {}",
+                        table.name, e
+                    );
+                }
+            }
+        }
+    });
+}
+
+fn table_path(table_name: &str) -> String {
+    Path::new(DB_PATH.get().unwrap())
+        .join(table_name)
+        .to_string_lossy()
+        .into_owned()
+}
+
+/// Get the opened table from the registry, or open it
+fn get_or_open_table(table_name: &str) -> anyhow::Result<Arc<LanceTable>> {
+    let rt = RUNTIME.get().unwrap();
+    let tables = TABLES.get().unwrap();
+
+    if let Some(table) = tables.lock().unwrap().get(table_name) {
+        return Ok(table.clone());
+    }
+
+    // Open outside of the registry lock, opening one table must not block the others
+    let mut manager = new_table_manager(table_name);
+    rt.block_on(manager.open_table())?;
+    let table = Arc::new(LanceTable {
+        name: table_name.to_string(),
+        manager: RwLock::new(manager),
+        write_buffer: Mutex::new(WriteBuffer::new(WriteBufferOptions::default())),
+    });
+
+    // Another thread may have opened the same table in the meantime, keep the first one
+    let mut tables_guard = tables.lock().unwrap();
+    if let Some(existing) = tables_guard.get(table_name) {
+        return Ok(existing.clone());
+    }
+    tables_guard.insert(table_name.to_string(), table.clone());
+    spawn_write_buffer_flusher(rt, Arc::downgrade(&table));
+    Ok(table)
+}
+
+/// C representation of the runtime and I/O settings, see LanceInitOptions in lance_ffi.h
+#[repr(C)]
+pub struct LanceInitOptions {
+    pub worker_threads: c_int,
+    pub max_blocking_threads: c_int,
+    pub io_concurrency: c_int,
+    pub cpu_threads: c_int,
+    pub io_block_size: i64,
+    pub batch_readahead: c_int,
+    pub cpu_affinity_mask: u64,
+}
+
+/// I/O settings applied to every table and scan, set once at initialization
+#[derive(Debug, Default)]
+struct IoSettings {
+    io_block_size: Option<usize>,
+    batch_readahead: Option<usize>,
+}
+
+static IO_SETTINGS: OnceLock<IoSettings> = OnceLock::new();
+
+/// Scan options carrying the defaults given at initialization
+pub(crate) fn default_scan_options() -> ScanOptions {
+    let mut options = ScanOptions::default();
+    if let Some(settings) = IO_SETTINGS.get() {
+        options.batch_readahead = settings.batch_readahead;
+    }
+    options
+}
+
+fn new_table_manager(table_name: &str) -> LanceTableManager {
+    let manager = LanceTableManager::new(&table_path(table_name));
+    match IO_SETTINGS
+        .get()
+        .and_then(|settings| settings.io_block_size)
+    {
+        Some(io_block_size) => manager.with_io_block_size(io_block_size),
+        None => manager,
+    }
+}
+
+/// Whether mask sets at least one of the CPUs the calling thread may run on (CPU 0 to 63)
+fn is_usable_cpu_mask(mask: u64) -> bool {
+    unsafe {
+        let mut allowed: libc::cpu_set_t = std::mem::zeroed();
+        if libc::sched_getaffinity(0, std::mem::size_of::<libc::cpu_set_t>(), &mut allowed) != 0 {
+            // Unknown, sched_setaffinity reports the error of each thread
+            return true;
+        }
+        (0..64).any(|cpu| mask & (1u64 << cpu) != 0 && libc::CPU_ISSET(cpu, &allowed))
+    }
+}
+
+/// Restrict the calling thread to the CPUs set in mask (CPU 0 to 63)
+fn pin_current_thread(mask: u64) {
+    unsafe {
+        let mut cpu_set: libc::cpu_set_t = std::mem::zeroed();
+        for cpu in 0..64 {
+            if mask & (1u64 << cpu) != 0 {
+                libc::CPU_SET(cpu, &mut cpu_set);
+            }
+        }
+        if libc::sched_setaffinity(0, std::mem::size_of::<libc::cpu_set_t>(), &cpu_set) != 0 {
+            println!(
+                "[rust]: Failed to set cpu affinity {:#x}: {}",
+                mask,
+                std::io::Error::last_os_error()
+            );
+        }
+    }
+}
+
+fn build_runtime(options: Option<&LanceInitOptions>) -> std::io::Result<Runtime> {
+    let mut builder = tokio::runtime::Builder::new_multi_thread();
+    builder.enable_all().thread_name("lance-runtime");
+    if let Some(options) = options {
+        if options.worker_threads > 0 {
+            builder.worker_threads(options.worker_threads as usize);
+        }
+        if options.max_blocking_threads > 0 {
+            builder.max_blocking_threads(options.max_blocking_threads as usize);
+        }
+        // Applies to the worker and blocking threads of this runtime only. Lance decodes on its own CPU
+        // runtime and reads on its I/O scheduler threads, which are not pinned
+        let mask = options.cpu_affinity_mask;
+        if mask != 0 {
+            builder.on_thread_start(move || pin_current_thread(mask));
+        }
+    }
+    builder.build()
+}
 
 // Initialize the Lance manager and runtime
 #[no_mangle]
 pub extern "C" fn lance_init(db_path: *const c_char) -> c_int {
+    lance_init_with_options(db_path, std::ptr::null())
+}
+
+// Initialize the Lance manager and a runtime tuned by options, options can be null
+#[no_mangle]
+pub extern "C" fn lance_init_with_options(
+    db_path: *const c_char,
+    options: *const LanceInitOptions,
+) -> c_int {
     // Check if already initialized
     if RUNTIME.get().is_some() {
         println!("[rust]: Already initialized");
         return 1;
     }
 
-    let rt = Runtime::new().unwrap();
+    let options = unsafe { options.as_ref() };
+    if let Some(options) = options {
+        if options.cpu_affinity_mask != 0 && !is_usable_cpu_mask(options.cpu_affinity_mask) {
+            println!(
+                "[rust]: CPU affinity mask {:#x} sets no CPU available to the process",
+                options.cpu_affinity_mask
+            );
+            return -1;
+        }
+    }
+    let rt = match build_runtime(options) {
+        Ok(rt) => rt,
+        Err(e) => {
+            println!("[rust]: Failed to build runtime: {}", e);
+            return -1;
+        }
+    };
     let path_str = unsafe { CStr::from_ptr(db_path).to_str().unwrap() };
 
+    let mut io_settings = IoSettings::default();
+    if let Some(options) = options {
+        // Read by Lance when its I/O scheduler and its CPU runtime are created, so they must be set before
+        // any table is opened. Setting the environment races with any other thread reading it, hence the
+        // caller must initialize before starting its threads
+        if options.io_concurrency > 0 {
+            std::env::set_var("LANCE_IO_THREADS", options.io_concurrency.to_string());
+        }
+        if options.cpu_threads > 0 {
+            std::env::set_var("LANCE_CPU_THREADS", options.cpu_threads.to_string());
+        }
+        if options.io_block_size > 0 {
+            io_settings.io_block_size = Some(options.io_block_size as usize);
+        }
+        if options.batch_readahead > 0 {
+            io_settings.batch_readahead = Some(options.batch_readahead as usize);
+        }
+    }
+    println!("[rust]: Initialized with {:?}", io_settings);
+
     // Create dataset directory if it doesn't exist
     std::fs::create_dir_all(path_str).unwrap();
     println!("[rust]: Directory created successfully: {}", path_str);
 
-    let manager = LanceTableManager::new(path_str);
-
-    // Set the runtime and manager using OnceLock
+    // Set the runtime and table registry using OnceLock
     RUNTIME.set(rt).unwrap();
-    if MANAGER.set(Mutex::new(manager)).is_err() {
+    if IO_SETTINGS.set(io_settings).is_err()
+        || DB_PATH.set(path_str.to_string()).is_err()
+        || TABLES.set(Mutex::new(HashMap::new())).is_err()
+    {
         return 1;
     }
 
@@ -44,20 +282,45 @@ pub extern "C" fn lance_init(db_path: *const c_char) -> c_int {
 // Create a new Lance table
 #[no_mangle]
 pub extern "C" fn lance_create_table(table_name: *const c_char) -> c_int {
+    let _timer = METRICS.create_latency.start();
+    let rt = RUNTIME.get().unwrap();
+    let name_str = unsafe { CStr::from_ptr(table_name).to_str().unwrap() };
+
+    let manager = new_table_manager(name_str);
+
+    match rt.block_on(manager.create_table(create_sample_schema())) {
+        Ok(_) => {
+            println!("[rust]: Table '{}' created successfully", name_str);
+            0
+        }
+        Err(e) => {
+            println!("[rust]: Failed to create table '{}': {}", name_str, e);
+            -3
+        }
+    }
+}
+
+/// Create a new empty Lance table with the given schema, the schema is still owned by the caller
+#[no_mangle]
+pub extern "C" fn lance_create_table_with_schema(
+    table_name: *const c_char,
+    schema: *const FFI_ArrowSchema,
+) -> c_int {
+    let _timer = METRICS.create_latency.start();
     let rt = RUNTIME.get().unwrap();
-    let manager = MANAGER.get().unwrap();
     let name_str = unsafe { CStr::from_ptr(table_name).to_str().unwrap() };
 
-    // Create sample data for table schema - need at least one meaningful record
-    let _sample_data = vec![SampleData {
-        id: 1,
-        name: "initial".to_string(),
-        value: 100,
-    }];
+    let schema = match Schema::try_from(unsafe { &*schema }) {
+        Ok(schema) => Arc::new(schema),
+        Err(e) => {
+            println!("[rust]: Failed to import schema: {}", e);
+            return -2;
+        }
+    };
 
-    let manager_guard = manager.lock().unwrap();
+    let manager = new_table_manager(name_str);
 
-    match rt.block_on(manager_guard.create_table()) {
+    match rt.block_on(manager.create_table(schema)) {
         Ok(_) => {
             println!("[rust]: Table '{}' created successfully", name_str);
             0
@@ -69,35 +332,77 @@ pub extern "C" fn lance_create_table(table_name: *const c_char) -> c_int {
     }
 }
 
-/// Write existing table with Arrow stream data using FFI_ArrowArrayStream
+/// Create a new Lance table with the schema and data of the given Arrow stream
 #[no_mangle]
-pub extern "C" fn lance_write_arrow_stream(
+pub extern "C" fn lance_create_table_from_stream(
     table_name: *const c_char,
     stream_addr: *mut FFI_ArrowArrayStream,
-    is_overwrite: bool,
 ) -> c_int {
+    let _timer = METRICS.create_latency.start();
     let rt = RUNTIME.get().unwrap();
-    let manager = MANAGER.get().unwrap();
-    let table_name_str = unsafe { CStr::from_ptr(table_name).to_str().unwrap() };
-    let mut manager_guard = manager.lock().unwrap();
+    let name_str = unsafe { CStr::from_ptr(table_name).to_str().unwrap() };
+
+    let batch_iter = match import_arrow_stream(stream_addr) {
+        Ok(reader) => reader,
+        Err(err) => {
+            println!(
+                "[rust]: Failed to create ArrowArrayStreamReader from FFI stream: {}",
+                err
+            );
+            return 1;
+        }
+    };
+
+    let manager = new_table_manager(name_str);
+
+    match rt.block_on(manager.create_table_from_stream(batch_iter)) {
+        Ok(_) => {
+            println!("[rust]: Table '{}' created successfully", name_str);
+            0
+        }
+        Err(e) => {
+            println!("[rust]: Failed to create table '{}': {}", name_str, e);
+            -3
+        }
+    }
+}
+
+/// Open an existing table and return its handle, NULL on error. Opening the same table twice
+/// returns handles sharing the same state. Every handle must be released by lance_close_table.
+#[no_mangle]
+pub extern "C" fn lance_open_table(table_name: *const c_char) -> *const LanceTable {
+    let name_str = unsafe { CStr::from_ptr(table_name).to_str().unwrap() };
+
+    match get_or_open_table(name_str) {
+        Ok(table) => {
+            println!("[rust]: Table '{}' opened successfully", name_str);
+            Arc::into_raw(table)
+        }
+        Err(e) => {
+            println!("[rust]: Failed to open table '{}': {}", name_str, e);
+            std::ptr::null()
+        }
+    }
+}
 
-    // Open the table first
-    rt.block_on(manager_guard.open_table()).unwrap();
+/// Release a handle returned by lance_open_table
+#[no_mangle]
+pub extern "C" fn lance_close_table(table: *const LanceTable) {
+    if !table.is_null() {
+        // SAFETY: The handle was created by Arc::into_raw in lance_open_table
+        drop(unsafe { Arc::from_raw(table) });
+    }
+}
 
+/// Import a C stream as a RecordBatchReader which is safe to be driven from any thread
+pub(crate) fn import_arrow_stream(
+    stream_addr: *mut FFI_ArrowArrayStream,
+) -> Result<Box<dyn RecordBatchReader + Send + 'static>, ArrowError> {
     let stream = unsafe { &mut *(stream_addr as *mut FFI_ArrowArrayStream) };
 
     // SAFETY: We take ownership of the provided FFI_ArrowArrayStream to create a reader.
     let stream_reader =
-        match unsafe { arrow::ffi_stream::ArrowArrayStreamReader::from_raw(&mut *stream) } {
-            Ok(reader) => reader,
-            Err(err) => {
-                println!(
-                    "[rust]: Failed to create ArrowArrayStreamReader from FFI stream: {}",
-                    err
-                );
-                return 1;
-            }
-        };
+        unsafe { arrow::ffi_stream::ArrowArrayStreamReader::from_raw(&mut *stream) }?;
 
     // Capture schema eagerly to avoid any potential ordering issues with producers
     // that expect get_schema to be called prior to get_next.
@@ -153,14 +458,52 @@ pub extern "C" fn lance_write_arrow_stream(
         }
     }
 
-    let batch_iter: Box<dyn RecordBatchReader + Send + 'static> =
-        Box::new(ControlledRecordBatchReader { schema, tx: cmd_tx });
+    Ok(Box::new(CountingReader::new(
+        ControlledRecordBatchReader { schema, tx: cmd_tx },
+        Direction::Import,
+    )))
+}
+
+/// Export a reader as the C stream at stream_addr, counting the batches handed out to C
+pub(crate) fn export_arrow_stream<R: RecordBatchReader + Send + 'static>(
+    reader: R,
+    stream_addr: *mut FFI_ArrowArrayStream,
+) {
+    let reader = CountingReader::new(reader, Direction::Export);
+    unsafe {
+        std::ptr::write(stream_addr, FFI_ArrowArrayStream::new(Box::new(reader)));
+    }
+}
+
+/// Write table with Arrow stream data using FFI_ArrowArrayStream
+#[no_mangle]
+pub extern "C" fn lance_table_write_arrow_stream(
+    table: *const LanceTable,
+    stream_addr: *mut FFI_ArrowArrayStream,
+    is_overwrite: bool,
+) -> c_int {
+    let _timer = METRICS.write_latency.start();
+    let rt = RUNTIME.get().unwrap();
+    let table = unsafe { &*table };
+
+    let batch_iter = match import_arrow_stream(stream_addr) {
+        Ok(reader) => reader,
+        Err(err) => {
+            println!(
+                "[rust]: Failed to create ArrowArrayStreamReader from FFI stream: {}",
+                err
+            );
+            return 1;
+        }
+    };
+
+    let mut manager_guard = table.manager.blocking_write();
 
     match rt.block_on(manager_guard.write_from_stream(batch_iter, is_overwrite)) {
         Ok(_) => {
             println!(
                 "[rust]: Arrow stream data written successfully in table '{}'",
-                table_name_str
+                table.name
             );
             0
         }
@@ -171,54 +514,305 @@ pub extern "C" fn lance_write_arrow_stream(
     }
 }
 
-/// Read data from a Lance table as Arrow stream using FFI_ArrowArrayStream
+/// Write existing table with Arrow stream data using FFI_ArrowArrayStream
+#[no_mangle]
+pub extern "C" fn lance_write_arrow_stream(
+    table_name: *const c_char,
+    stream_addr: *mut FFI_ArrowArrayStream,
+    is_overwrite: bool,
+) -> c_int {
+    let table_name_str = unsafe { CStr::from_ptr(table_name).to_str().unwrap() };
+    let table = match get_or_open_table(table_name_str) {
+        Ok(table) => table,
+        Err(e) => {
+            println!("[rust]: Failed to open table '{}': {}", table_name_str, e);
+            return 1;
+        }
+    };
+    lance_table_write_arrow_stream(Arc::as_ptr(&table), stream_addr, is_overwrite)
+}
+
+/// Read data from a Lance table as Arrow stream using FFI_ArrowArrayStream. Scanner batches are
+/// passed through untouched, so their buffers reach the consumer without any copy
 #[no_mangle]
 pub extern "C" fn lance_read_arrow_stream(
     table_name: *const c_char,
     stream_addr: *mut FFI_ArrowArrayStream,
 ) -> c_int {
+    lance_read_arrow_stream_with_options(table_name, std::ptr::null(), stream_addr)
+}
+
+/// C representation of ScanOptions, see LanceScanOptions in lance_ffi.h
+#[repr(C)]
+pub struct LanceScanOptions {
+    pub columns: *const *const c_char,
+    pub num_columns: usize,
+    pub filter: *const c_char,
+    pub limit: i64,
+    pub batch_size: i64,
+    pub prefetch_batches: i64,
+    pub io_parallelism: i64,
+    pub with_row_id: bool,
+    pub version: i64,
+    pub since_version: i64,
+}
+
+impl LanceScanOptions {
+    /// Convert to the owned ScanOptions, null pointers and non-positive numbers mean "not set"
+    pub(crate) unsafe fn to_scan_options(&self) -> Result<ScanOptions, std::str::Utf8Error> {
+        let mut options = default_scan_options();
+        if !self.columns.is_null() {
+            let mut columns = Vec::with_capacity(self.num_columns);
+            for i in 0..self.num_columns {
+                columns.push(CStr::from_ptr(*self.columns.add(i)).to_str()?.to_string());
+            }
+            options.columns = Some(columns);
+        }
+        if !self.filter.is_null() {
+            options.filter = Some(CStr::from_ptr(self.filter).to_str()?.to_string());
+        }
+        if self.limit > 0 {
+            options.limit = Some(self.limit);
+        }
+        if self.batch_size > 0 {
+            options.batch_size = Some(self.batch_size as usize);
+        }
+        if self.prefetch_batches > 0 {
+            options.batch_readahead = Some(self.prefetch_batches as usize);
+        }
+        if self.io_parallelism > 0 {
+            options.io_parallelism = Some(self.io_parallelism as usize);
+        }
+        options.with_row_id = self.with_row_id;
+        if self.version > 0 {
+            options.version = Some(self.version as u64);
+        }
+        if self.since_version > 0 {
+            options.since_version = Some(self.since_version as u64);
+        }
+        Ok(options)
+    }
+}
+
+/// Read data from a table handle with projection, filter, limit and batch size pushed down to the scanner.
+/// Batches are streamed with a bounded read-ahead instead of being materialized up front.
+/// Concurrent calls on the same handle scan in parallel.
+#[no_mangle]
+pub extern "C" fn lance_table_read_arrow_stream(
+    table: *const LanceTable,
+    options: *const LanceScanOptions,
+    stream_addr: *mut FFI_ArrowArrayStream,
+) -> c_int {
+    let _timer = METRICS.scan_latency.start();
     let rt = RUNTIME.get().unwrap();
-    let manager = MANAGER.get().unwrap();
+    let table = unsafe { &*table };
+
+    let scan_options = if options.is_null() {
+        default_scan_options()
+    } else {
+        match unsafe { (*options).to_scan_options() } {
+            Ok(scan_options) => scan_options,
+            Err(e) => {
+                println!("[rust]: Invalid scan options: {}", e);
+                return 1;
+            }
+        }
+    };
+
+    // The scan works on a snapshot, so the table lock is released before any batch is read
+    let scan_result = {
+        let manager_guard = table.manager.blocking_read();
+        rt.block_on(manager_guard.scan_stream(&scan_options))
+    };
+
+    match scan_result {
+        Ok((schema, stream)) => {
+            let prefetch = scan_options
+                .batch_readahead
+                .unwrap_or(DEFAULT_PREFETCH_BATCHES);
+            let reader = PrefetchRecordBatchReader::spawn(rt, schema, stream, prefetch);
+            export_arrow_stream(reader, stream_addr);
+            println!(
+                "[rust]: Start streaming data from table '{}' as Arrow stream",
+                table.name
+            );
+            0
+        }
+        Err(e) => {
+            println!("[rust]: Failed to read data: {}", e);
+            1
+        }
+    }
+}
+
+/// Read data from a Lance table with projection, filter, limit and batch size pushed down to the scanner
+#[no_mangle]
+pub extern "C" fn lance_read_arrow_stream_with_options(
+    table_name: *const c_char,
+    options: *const LanceScanOptions,
+    stream_addr: *mut FFI_ArrowArrayStream,
+) -> c_int {
     let table_name_str = unsafe { CStr::from_ptr(table_name).to_str().unwrap() };
+    let table = match get_or_open_table(table_name_str) {
+        Ok(table) => table,
+        Err(e) => {
+            println!("[rust]: Failed to open table '{}': {}", table_name_str, e);
+            return 1;
+        }
+    };
+    lance_table_read_arrow_stream(Arc::as_ptr(&table), options, stream_addr)
+}
 
-    let mut manager_guard = manager.lock().unwrap();
+/// Current version of the table, negative on error
+#[no_mangle]
+pub extern "C" fn lance_table_version(table: *const LanceTable) -> i64 {
+    let table = unsafe { &*table };
+    let manager_guard = table.manager.blocking_read();
+    match manager_guard.version() {
+        Ok(version) => version as i64,
+        Err(e) => {
+            println!(
+                "[rust]: Failed to get version of table '{}': {}",
+                table.name, e
+            );
+            -1
+        }
+    }
+}
 
-    // Open the table first
-    rt.block_on(manager_guard.open_table()).unwrap();
+/// Configure the thresholds of buffered writes, non-positive values keep the current setting
+#[no_mangle]
+pub extern "C" fn lance_table_configure_write_buffer(
+    table: *const LanceTable,
+    max_rows: i64,
+    max_bytes: i64,
+    max_delay_ms: i64,
+) {
+    let table = unsafe { &*table };
+    let mut write_buffer = table.write_buffer.lock().unwrap();
+    let mut options = write_buffer.options().clone();
+    if max_rows > 0 {
+        options.max_rows = max_rows as usize;
+    }
+    if max_bytes > 0 {
+        options.max_bytes = max_bytes as usize;
+    }
+    if max_delay_ms > 0 {
+        options.max_delay = Duration::from_millis(max_delay_ms as u64);
+    }
+    write_buffer.set_options(options);
+}
 
-    match rt.block_on(manager_guard.read_all_data()) {
-        Ok(data) => {
-            // Convert SampleData to RecordBatch
-            let batch = crate::sample_data_to_record_batch(&data).unwrap();
-            // Create an iterator that yields the single batch
-            let batches = vec![batch];
+/// Append the stream to the write buffer of the table. The buffer is committed as a single
+/// append once one of its thresholds is reached, or by lance_table_flush
+#[no_mangle]
+pub extern "C" fn lance_table_buffered_write_arrow_stream(
+    table: *const LanceTable,
+    stream_addr: *mut FFI_ArrowArrayStream,
+) -> c_int {
+    let table = unsafe { &*table };
+
+    // The stream is drained on the calling thread, no runtime involved
+    let stream = unsafe { &mut *stream_addr };
+    let stream_reader = match unsafe { arrow::ffi_stream::ArrowArrayStreamReader::from_raw(stream) }
+    {
+        Ok(reader) => reader,
+        Err(err) => {
+            println!(
+                "[rust]: Failed to create ArrowArrayStreamReader from FFI stream: {}",
+                err
+            );
+            return 1;
+        }
+    };
+
+    // Stage the whole stream first: a stream failing half way must not leave its first batches
+    // in the buffer, to be committed by a later flush
+    let mut batches = Vec::new();
+    for batch in stream_reader {
+        match batch {
+            Ok(batch) => {
+                record_batch(&batch, Direction::Import);
+                batches.push(batch);
+            }
+            Err(e) => {
+                println!("[rust]: Failed to read Arrow stream data: {}", e);
+                return 1;
+            }
+        }
+    }
 
-            // Create RecordBatchIterator from batches
-            let schema = batches[0].schema();
-            let batch_results: Vec<
-                Result<arrow::record_batch::RecordBatch, arrow::error::ArrowError>,
-            > = batches.into_iter().map(Ok).collect();
-            let batch_iter = RecordBatchIterator::new(batch_results.into_iter(), schema);
+    let should_flush = {
+        let mut write_buffer = table.write_buffer.lock().unwrap();
+        if let Err(e) = write_buffer.push_all(batches) {
+            println!("[rust]: Failed to buffer Arrow stream data: {}", e);
+            return 1;
+        }
+        write_buffer.should_flush()
+    };
 
-            // Export to FFI_ArrowArrayStream using new method
-            unsafe {
-                // First initialize the stream with empty values
-                std::ptr::write(stream_addr, FFI_ArrowArrayStream::empty());
+    if should_flush {
+        return lance_table_flush(table);
+    }
+    0
+}
 
-                // Try to create the stream
-                let new_stream = FFI_ArrowArrayStream::new(Box::new(batch_iter));
+/// Commit the write buffer of the table
+#[no_mangle]
+pub extern "C" fn lance_table_flush(table: *const LanceTable) -> c_int {
+    let rt = RUNTIME.get().unwrap();
+    let table = unsafe { &*table };
 
-                // Properly assign the stream to the pointer
-                std::ptr::write(stream_addr, new_stream);
-            }
+    match rt.block_on(flush_write_buffer(table)) {
+        Ok(rows) => {
             println!(
-                "[rust]: Data read successfully from table '{}' as Arrow stream",
-                table_name_str
+                "[rust]: Flushed {} buffered rows into table '{}'",
+                rows, table.name
             );
             0
         }
         Err(e) => {
-            println!("[rust]: Failed to read data: {}", e);
+            println!(
+                "[rust]: Failed to flush write buffer of table '{}': {}",
+                table.name, e
+            );
+            1
+        }
+    }
+}
+
+/// Merge small fragments into fragments of about target_rows_per_fragment rows
+#[no_mangle]
+pub extern "C" fn lance_table_compact(
+    table: *const LanceTable,
+    target_rows_per_fragment: i64,
+    fragments_removed: *mut i64,
+    fragments_added: *mut i64,
+) -> c_int {
+    let rt = RUNTIME.get().unwrap();
+    let table = unsafe { &*table };
+    let target_rows = if target_rows_per_fragment > 0 {
+        target_rows_per_fragment as usize
+    } else {
+        1024 * 1024
+    };
+
+    let mut manager_guard = table.manager.blocking_write();
+
+    match rt.block_on(manager_guard.compact(target_rows)) {
+        Ok((removed, added)) => {
+            unsafe {
+                if !fragments_removed.is_null() {
+                    *fragments_removed = removed as i64;
+                }
+                if !fragments_added.is_null() {
+                    *fragments_added = added as i64;
+                }
+            }
+            0
+        }
+        Err(e) => {
+            println!("[rust]: Failed to compact table '{}': {}", table.name, e);
             1
         }
     }
@@ -230,8 +824,68 @@ pub extern "C" fn lance_read_arrow_stream(
 /// Cleanup resources
 #[no_mangle]
 pub extern "C" fn lance_cleanup() {
+    // Commit the writes still sitting in the write buffers
+    if let (Some(rt), Some(tables)) = (RUNTIME.get(), TABLES.get()) {
+        let tables: Vec<Arc<LanceTable>> = tables.lock().unwrap().values().cloned().collect();
+        for table in tables {
+            if let Err(e) = rt.block_on(flush_write_buffer(&table)) {
+                println!(
+                    "[rust]: Failed to flush write buffer of table '{}': {}",
+                    table.name, e
+                );
+            }
+        }
+    }
     // Note: OnceLock doesn't support clearing values once set
     // This is intentional as cleanup in FFI contexts can be problematic
     // The resources will be cleaned up when the process exits
     println!("[rust]: Cleanup called, resources will be freed on process exit");
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use arrow::array::Int32Array;
+    use arrow::datatypes::{DataType, Field};
+    use arrow::record_batch::RecordBatch;
+    use futures::TryStreamExt;
+
+    #[test]
+    fn failed_flush_keeps_buffered_rows() {
+        let rt = Runtime::new().unwrap();
+        let dir =
+            std::env::temp_dir().join(format!("lance_ffi_failed_flush_{}", std::process::id()));
+        let _ = std::fs::remove_dir_all(&dir);
+        let path = dir.to_string_lossy().into_owned();
+        let schema = Arc::new(Schema::new(vec![Field::new("id", DataType::Int32, false)]));
+        rt.block_on(LanceTableManager::new(&path).create_table(schema.clone()))
+            .unwrap();
+
+        // The dataset is not opened, so the first commit fails
+        let table = LanceTable {
+            name: "failed_flush".to_string(),
+            manager: RwLock::new(LanceTableManager::new(&path)),
+            write_buffer: Mutex::new(WriteBuffer::new(WriteBufferOptions::default())),
+        };
+        let batch =
+            RecordBatch::try_new(schema, vec![Arc::new(Int32Array::from(vec![1, 2, 3]))]).unwrap();
+        table.write_buffer.lock().unwrap().push(batch).unwrap();
+        assert!(rt.block_on(flush_write_buffer(&table)).is_err());
+
+        rt.block_on(async {
+            table.manager.write().await.open_table().await.unwrap();
+            assert_eq!(flush_write_buffer(&table).await.unwrap(), 3);
+            assert_eq!(flush_write_buffer(&table).await.unwrap(), 0);
+
+            let manager_guard = table.manager.read().await;
+            let (_, stream) = manager_guard
+                .scan_stream(&ScanOptions::default())
+                .await
+                .unwrap();
+            let batches: Vec<RecordBatch> = stream.try_collect().await.unwrap();
+            let rows: usize = batches.iter().map(|batch| batch.num_rows()).sum();
+            assert_eq!(rows, 3);
+        });
+        let _ = std::fs::remove_dir_all(&dir);
+    }
+}
@@ -1,15 +1,107 @@
 use anyhow::Result;
-use arrow::record_batch::RecordBatchIterator;
-use futures::TryStreamExt;
+use arrow::array::Float32Array;
+use arrow::datatypes::SchemaRef;
+use arrow::record_batch::{RecordBatch, RecordBatchIterator};
+use std::collections::HashSet;
+use std::sync::atomic::Ordering;
 use std::sync::Arc;
 
-use crate::{create_sample_schema, record_batch_to_sample_data, SampleData};
+use lance::dataset::builder::DatasetBuilder;
+use lance::dataset::optimize::{compact_files, CompactionOptions};
+use lance::dataset::scanner::DatasetRecordBatchStream;
+use lance::dataset::{ProjectionRequest, ReadParams, WriteDestination, WriteMode, WriteParams};
+use lance::index::vector::VectorIndexParams;
+use lance::io::ObjectStoreParams;
 use lance::Dataset;
+use lance_index::scalar::ScalarIndexParams;
+use lance_index::{DatasetIndexExt, IndexType};
+use lance_linalg::distance::DistanceType;
+use lance_table::format::Fragment;
+
+use crate::metrics::{IoRequestCounter, METRICS};
+
+/// Options pushed down to the Lance scanner, all of them are optional
+#[derive(Debug, Clone, Default)]
+pub struct ScanOptions {
+    /// Columns to read, None means all columns
+    pub columns: Option<Vec<String>>,
+    /// SQL filter expression, e.g. "id > 3"
+    pub filter: Option<String>,
+    /// Max number of rows to return
+    pub limit: Option<i64>,
+    /// Number of rows per returned batch
+    pub batch_size: Option<usize>,
+    /// Number of decoded batches buffered ahead of the consumer
+    pub batch_readahead: Option<usize>,
+    /// Number of fragments read concurrently
+    pub io_parallelism: Option<usize>,
+    /// Append the "_rowid" column, which can be passed to take_rows later
+    pub with_row_id: bool,
+    /// Read this version instead of the latest one
+    pub version: Option<u64>,
+    /// Only read the rows appended after this version
+    pub since_version: Option<u64>,
+}
+
+/// IVF_PQ vector index parameters
+#[derive(Debug, Clone)]
+pub struct VectorIndexOptions {
+    /// Fixed size list of float32 column to index
+    pub column: String,
+    pub distance_type: DistanceType,
+    pub num_partitions: usize,
+    pub num_sub_vectors: usize,
+    pub num_bits: u8,
+    pub max_iterations: usize,
+    /// Replace the existing index on the column, if any
+    pub replace: bool,
+}
+
+/// Top-k nearest neighbour query
+#[derive(Debug, Clone)]
+pub struct VectorQuery {
+    pub column: String,
+    pub vector: Vec<f32>,
+    pub k: usize,
+    pub distance_type: DistanceType,
+    /// Number of IVF partitions to probe
+    pub nprobes: Option<usize>,
+    /// Re-rank k * refine_factor candidates with the original vectors
+    pub refine_factor: Option<u32>,
+    /// Apply the filter before the vector search instead of after it
+    pub prefilter: bool,
+    /// Brute force search if false
+    pub use_index: bool,
+    /// The projection and filter of the query, limit and batch_size are ignored
+    pub scan: ScanOptions,
+}
+
+/// Count the fragments of dataset which are not in previous, all of them without a previous version
+fn record_new_fragments(previous: Option<&Dataset>, dataset: &Dataset) {
+    let previous_ids: HashSet<u64> = previous
+        .map(|previous| {
+            previous
+                .fragments()
+                .iter()
+                .map(|fragment| fragment.id)
+                .collect()
+        })
+        .unwrap_or_default();
+    let created = dataset
+        .fragments()
+        .iter()
+        .filter(|fragment| !previous_ids.contains(&fragment.id))
+        .count();
+    METRICS
+        .fragments_created
+        .fetch_add(created as u64, Ordering::Relaxed);
+}
 
 /// Lance table operations for creating, writing, and reading data
 pub struct LanceTableManager {
     path: String,
     dataset: Option<Dataset>,
+    io_block_size: Option<usize>,
 }
 
 impl LanceTableManager {
@@ -18,6 +110,30 @@ impl LanceTableManager {
         Self {
             path: path.to_string(),
             dataset: None,
+            io_block_size: None,
+        }
+    }
+
+    /// Read the dataset files in requests of io_block_size bytes instead of the object store default
+    pub fn with_io_block_size(mut self, io_block_size: usize) -> Self {
+        self.io_block_size = Some(io_block_size);
+        self
+    }
+
+    /// Object store settings of the dataset, the store is wrapped to count the I/O requests
+    fn store_params(&self) -> ObjectStoreParams {
+        ObjectStoreParams {
+            block_size: self.io_block_size,
+            object_store_wrapper: Some(Arc::new(IoRequestCounter)),
+            ..ObjectStoreParams::default()
+        }
+    }
+
+    /// Write parameters of a new dataset
+    fn create_params(&self) -> WriteParams {
+        WriteParams {
+            store_params: Some(self.store_params()),
+            ..WriteParams::default()
         }
     }
 
@@ -27,94 +143,338 @@ impl LanceTableManager {
             // Already opened
             return Ok(());
         }
-        self.dataset = Some(Dataset::open(&self.path).await?);
+        let read_params = ReadParams {
+            store_options: Some(self.store_params()),
+            ..ReadParams::default()
+        };
+        self.dataset = Some(
+            DatasetBuilder::from_uri(&self.path)
+                .with_read_params(read_params)
+                .load()
+                .await?,
+        );
         Ok(())
     }
 
     /// Create a new Lance table with the given schema
-    pub async fn create_table(&self) -> Result<()> {
-        let schema = create_sample_schema();
-
+    pub async fn create_table(&self, schema: SchemaRef) -> Result<()> {
         // Create an empty table with the schema using Lance API
         let empty_batches = RecordBatchIterator::new(std::iter::empty(), schema);
 
-        Dataset::write(empty_batches, &self.path, None).await?;
+        Dataset::write(empty_batches, &self.path, Some(self.create_params())).await?;
 
         Ok(())
     }
 
+    /// Create a new Lance table with the schema and data of the given RecordBatchReader
+    pub async fn create_table_from_stream(
+        &self,
+        reader: Box<dyn arrow::record_batch::RecordBatchReader + Send + 'static>,
+    ) -> Result<()> {
+        let dataset = Dataset::write(reader, &self.path, Some(self.create_params())).await?;
+        record_new_fragments(None, &dataset);
+        Ok(())
+    }
+
     /// Write existing table with new data from RecordBatchReader
     pub async fn write_from_stream(
         &mut self,
         reader: Box<dyn arrow::record_batch::RecordBatchReader + Send + 'static>,
         is_overwrite: bool,
     ) -> Result<()> {
-        let write_params = lance::dataset::WriteParams {
+        let write_params = WriteParams {
             mode: if is_overwrite {
-                lance::dataset::WriteMode::Overwrite
+                WriteMode::Overwrite
             } else {
-                lance::dataset::WriteMode::Append
+                WriteMode::Append
             },
-            ..lance::dataset::WriteParams::default()
+            ..WriteParams::default()
         };
 
         println!("[rust]: Starting to write table with stream data...");
-        Dataset::write(
+        // The returned dataset is the committed version, no need to reopen it from storage
+        let previous = self
+            .dataset
+            .clone()
+            .ok_or_else(|| anyhow::anyhow!("No dataset opened. Call open_table first."))?;
+        let dataset = Dataset::write(
             reader,
-            lance::dataset::WriteDestination::Dataset(Arc::new(self.dataset.clone().unwrap())),
+            WriteDestination::Dataset(Arc::new(previous.clone())),
             Some(write_params),
         )
         .await?;
-        println!("[rust]: Stream data written successfully.");
-
-        // Reload the dataset to get the latest version and avoid commit conflicts
-        self.dataset = Some(Dataset::open(&self.path).await?);
-        println!("[rust]: Dataset reloaded after write operation.");
+        record_new_fragments((!is_overwrite).then_some(&previous), &dataset);
+        println!(
+            "[rust]: Stream data written successfully, version {}.",
+            dataset.version().version
+        );
+        self.dataset = Some(dataset);
 
         Ok(())
     }
 
-    /// Read all data from a Lance table using low-level Lance API
-    pub async fn read_all_data(&self) -> Result<Vec<SampleData>> {
+    /// Append buffered batches as a single write, so that they end up in as few fragments as possible
+    pub async fn append_batches(
+        &mut self,
+        schema: SchemaRef,
+        batches: Vec<RecordBatch>,
+    ) -> Result<()> {
+        let reader = RecordBatchIterator::new(batches.into_iter().map(Ok), schema);
+        self.write_from_stream(Box::new(reader), false).await
+    }
+
+    /// Rewrite small fragments into fragments of about target_rows_per_fragment rows,
+    /// returns the number of fragments removed and added
+    pub async fn compact(&mut self, target_rows_per_fragment: usize) -> Result<(usize, usize)> {
+        if let Some(dataset) = self.dataset.as_mut() {
+            let options = CompactionOptions {
+                target_rows_per_fragment,
+                ..CompactionOptions::default()
+            };
+            let metrics = compact_files(dataset, options, None).await?;
+            println!(
+                "[rust]: Compaction finished, {} fragments removed, {} fragments added",
+                metrics.fragments_removed, metrics.fragments_added
+            );
+            METRICS
+                .fragments_created
+                .fetch_add(metrics.fragments_added as u64, Ordering::Relaxed);
+            Ok((metrics.fragments_removed, metrics.fragments_added))
+        } else {
+            Err(anyhow::anyhow!("No dataset opened. Call open_table first."))
+        }
+    }
+
+    /// Scan with projection, filter, limit and batch size pushed down to the Lance scanner.
+    /// Nothing is materialized here, the returned stream reads a snapshot of the current version,
+    /// so it stays valid after the table lock is released.
+    pub async fn scan_stream(
+        &self,
+        options: &ScanOptions,
+    ) -> Result<(SchemaRef, DatasetRecordBatchStream)> {
         if let Some(dataset) = &self.dataset {
-            // Create a scanner and convert to stream
-            let scanner = dataset.scan();
-            let mut stream = scanner.try_into_stream().await?;
-            println!("[rust]: Scanner created, start to read data...");
-
-            let mut results = Vec::new();
-            while let Some(batch) = stream.try_next().await? {
-                let sample_data = record_batch_to_sample_data(&batch)?;
-                results.extend(sample_data);
+            // Time travel to the requested version, the latest one is already in memory
+            let dataset = match options.version {
+                Some(version) if version != dataset.version().version => {
+                    dataset.checkout_version(version).await?
+                }
+                _ => dataset.clone(),
+            };
+            let mut scanner = dataset.scan();
+            if let Some(since_version) = options.since_version {
+                scanner.with_fragments(Self::appended_fragments(&dataset, since_version).await?);
+            }
+            if let Some(columns) = &options.columns {
+                scanner.project(columns)?;
+            }
+            if let Some(filter) = &options.filter {
+                scanner.filter(filter)?;
+            }
+            if options.limit.is_some() {
+                scanner.limit(options.limit, None)?;
             }
+            if let Some(batch_size) = options.batch_size {
+                scanner.batch_size(batch_size);
+            }
+            if let Some(batch_readahead) = options.batch_readahead {
+                scanner.batch_readahead(batch_readahead);
+            }
+            if let Some(io_parallelism) = options.io_parallelism {
+                scanner.fragment_readahead(io_parallelism);
+            }
+            if options.with_row_id {
+                scanner.with_row_id();
+            }
+            let schema = scanner.schema().await?;
+            let stream = scanner.try_into_stream().await?;
+            println!("[rust]: Scanner created with {:?}", options);
+            Ok((schema, stream))
+        } else {
+            Err(anyhow::anyhow!("No dataset opened. Call open_table first."))
+        }
+    }
 
-            println!("[rust]: Finished reading all data.");
-            Ok(results)
+    /// Fragments of dataset which did not exist in since_version. Appends always create new fragments,
+    /// so these hold exactly the appended rows, as long as no fragment was rewritten in between
+    async fn appended_fragments(dataset: &Dataset, since_version: u64) -> Result<Vec<Fragment>> {
+        let base = dataset.checkout_version(since_version).await?;
+        let base_ids: HashSet<u64> = base
+            .fragments()
+            .iter()
+            .map(|fragment| fragment.id)
+            .collect();
+        let current_ids: HashSet<u64> = dataset
+            .fragments()
+            .iter()
+            .map(|fragment| fragment.id)
+            .collect();
+        if !base_ids.is_subset(&current_ids) {
+            return Err(anyhow::anyhow!(
+                "Fragments of version {} were rewritten (overwrite or compaction) before version {}, \
+                 the changes are not append-only",
+                since_version,
+                dataset.version().version
+            ));
+        }
+        Ok(dataset
+            .fragments()
+            .iter()
+            .filter(|fragment| !base_ids.contains(&fragment.id))
+            .cloned()
+            .collect())
+    }
+
+    /// Version of the in-memory dataset, which includes every write done through this manager
+    pub fn version(&self) -> Result<u64> {
+        if let Some(dataset) = &self.dataset {
+            Ok(dataset.version().version)
         } else {
             Err(anyhow::anyhow!("No dataset opened. Call open_table first."))
         }
     }
 
-    /// Read filtered data from a Lance table using low-level Lance API
-    pub async fn read_filtered_data(&self, filter: &str) -> Result<Vec<SampleData>> {
+    /// Build an IVF_PQ index on a vector column
+    pub async fn create_vector_index(&mut self, options: &VectorIndexOptions) -> Result<()> {
+        if let Some(dataset) = self.dataset.as_mut() {
+            let params = VectorIndexParams::ivf_pq(
+                options.num_partitions,
+                options.num_bits,
+                options.num_sub_vectors,
+                options.distance_type,
+                options.max_iterations,
+            );
+            println!("[rust]: Start to build vector index with {:?}", options);
+            dataset
+                .create_index(
+                    &[options.column.as_str()],
+                    IndexType::Vector,
+                    None,
+                    &params,
+                    options.replace,
+                )
+                .await?;
+            println!("[rust]: Vector index built on column '{}'", options.column);
+            Ok(())
+        } else {
+            Err(anyhow::anyhow!("No dataset opened. Call open_table first."))
+        }
+    }
+
+    /// Top-k nearest neighbour search, the results carry an extra "_distance" column
+    pub async fn vector_search(
+        &self,
+        query: &VectorQuery,
+    ) -> Result<(SchemaRef, DatasetRecordBatchStream)> {
         if let Some(dataset) = &self.dataset {
-            // Create a scanner with filter and convert to stream
-            let mut scan = dataset.scan();
-            let scanner = scan.filter(filter)?;
-            let mut stream = scanner.try_into_stream().await?;
-
-            let mut results = Vec::new();
-            while let Some(batch) = stream.try_next().await? {
-                let sample_data = record_batch_to_sample_data(&batch)?;
-                results.extend(sample_data);
+            let mut scanner = dataset.scan();
+            if let Some(columns) = &query.scan.columns {
+                scanner.project(columns)?;
+            }
+            if let Some(filter) = &query.scan.filter {
+                scanner.filter(filter)?;
+            }
+            let q = Float32Array::from(query.vector.clone());
+            scanner
+                .nearest(&query.column, &q, query.k)?
+                .distance_metric(query.distance_type)
+                .use_index(query.use_index)
+                .prefilter(query.prefilter);
+            if let Some(nprobes) = query.nprobes {
+                scanner.nprobs(nprobes);
             }
+            if let Some(refine_factor) = query.refine_factor {
+                scanner.refine(refine_factor);
+            }
+            let schema = scanner.schema().await?;
+            let stream = scanner.try_into_stream().await?;
+            Ok((schema, stream))
+        } else {
+            Err(anyhow::anyhow!("No dataset opened. Call open_table first."))
+        }
+    }
 
-            Ok(results)
+    /// Build a scalar index (IndexType::BTree or IndexType::Bitmap) on a column, which is used by
+    /// the scanner to evaluate filters on that column instead of scanning it
+    pub async fn create_scalar_index(
+        &mut self,
+        column: &str,
+        index_type: IndexType,
+        replace: bool,
+    ) -> Result<()> {
+        if let Some(dataset) = self.dataset.as_mut() {
+            dataset
+                .create_index(
+                    &[column],
+                    index_type,
+                    None,
+                    &ScalarIndexParams::default(),
+                    replace,
+                )
+                .await?;
+            println!(
+                "[rust]: {:?} index built on column '{}'",
+                index_type, column
+            );
+            Ok(())
         } else {
             Err(anyhow::anyhow!("No dataset opened. Call open_table first."))
         }
     }
 
+    /// Fetch rows by the row ids returned in "_rowid", without any scan
+    pub async fn take_rows(
+        &self,
+        row_ids: &[u64],
+        columns: Option<&[String]>,
+    ) -> Result<RecordBatch> {
+        if let Some(dataset) = &self.dataset {
+            if row_ids.is_empty() {
+                // Nothing to read, the batch keeps the projected schema
+                let schema = match columns {
+                    Some(columns) => dataset.schema().project(columns)?,
+                    None => dataset.schema().clone(),
+                };
+                return Ok(RecordBatch::new_empty(Arc::new(
+                    arrow::datatypes::Schema::from(&schema),
+                )));
+            }
+            let projection = match columns {
+                Some(columns) => ProjectionRequest::from_columns(columns, dataset.schema()),
+                None => ProjectionRequest::from_schema(dataset.schema().clone()),
+            };
+            Ok(dataset.take_rows(row_ids, projection).await?)
+        } else {
+            Err(anyhow::anyhow!("No dataset opened. Call open_table first."))
+        }
+    }
+
+    /// Fetch rows whose key column is in keys. This is a filtered scan, which is answered
+    /// by the scalar index of the column if there is one
+    pub async fn take_by_keys(
+        &self,
+        column: &str,
+        keys: &[i64],
+        options: &ScanOptions,
+    ) -> Result<(SchemaRef, DatasetRecordBatchStream)> {
+        // "IN ()" is not valid SQL, no key matches no row but the stream keeps the projected schema
+        let key_filter = if keys.is_empty() {
+            "false".to_string()
+        } else {
+            let key_list = keys
+                .iter()
+                .map(|key| key.to_string())
+                .collect::<Vec<_>>()
+                .join(", ");
+            format!("{} IN ({})", column, key_list)
+        };
+        let mut options = options.clone();
+        options.filter = Some(match &options.filter {
+            Some(filter) => format!("({}) AND ({})", key_filter, filter),
+            None => key_filter,
+        });
+        self.scan_stream(&options).await
+    }
+
     /// Get table schema information
     pub async fn get_table_schema(&self) -> Result<arrow::datatypes::SchemaRef> {
         if let Some(dataset) = &self.dataset {
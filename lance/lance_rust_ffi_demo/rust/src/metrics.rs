@@ -0,0 +1,346 @@
+use arrow::{
+    datatypes::SchemaRef,
+    error::ArrowError,
+    record_batch::{RecordBatch, RecordBatchReader},
+};
+use async_trait::async_trait;
+use bytes::Bytes;
+use futures::stream::BoxStream;
+use lance::io::WrappingObjectStore;
+use object_store::{
+    path::Path, GetOptions, GetResult, ListResult, MultipartUpload, ObjectMeta, ObjectStore,
+    PutMultipartOpts, PutOptions, PutPayload, PutResult,
+};
+use std::ops::Range;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+/// Number of latency buckets, bucket i counts latencies below 2^i microseconds which did not fit
+/// in bucket i - 1, the last one counts everything above
+pub const LATENCY_BUCKETS: usize = 24;
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicU64 = AtomicU64::new(0);
+
+/// Lock-free latency histogram with power of two buckets
+pub struct LatencyHistogram {
+    count: AtomicU64,
+    sum_us: AtomicU64,
+    max_us: AtomicU64,
+    buckets: [AtomicU64; LATENCY_BUCKETS],
+}
+
+impl LatencyHistogram {
+    const fn new() -> Self {
+        Self {
+            count: ZERO,
+            sum_us: ZERO,
+            max_us: ZERO,
+            buckets: [ZERO; LATENCY_BUCKETS],
+        }
+    }
+
+    pub fn record(&self, latency: Duration) {
+        let us = latency.as_micros().min(u64::MAX as u128) as u64;
+        let bucket = ((u64::BITS - us.leading_zeros()) as usize).min(LATENCY_BUCKETS - 1);
+        self.buckets[bucket].fetch_add(1, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.sum_us.fetch_add(us, Ordering::Relaxed);
+        self.max_us.fetch_max(us, Ordering::Relaxed);
+    }
+
+    /// Start timing an operation, the latency is recorded when the returned timer is dropped
+    pub fn start(&self) -> LatencyTimer<'_> {
+        LatencyTimer {
+            histogram: self,
+            start: Instant::now(),
+        }
+    }
+
+    fn snapshot(&self) -> LanceLatencyHistogram {
+        LanceLatencyHistogram {
+            count: self.count.load(Ordering::Relaxed),
+            sum_us: self.sum_us.load(Ordering::Relaxed),
+            max_us: self.max_us.load(Ordering::Relaxed),
+            buckets: std::array::from_fn(|i| self.buckets[i].load(Ordering::Relaxed)),
+        }
+    }
+
+    fn reset(&self) {
+        self.count.store(0, Ordering::Relaxed);
+        self.sum_us.store(0, Ordering::Relaxed);
+        self.max_us.store(0, Ordering::Relaxed);
+        for bucket in &self.buckets {
+            bucket.store(0, Ordering::Relaxed);
+        }
+    }
+}
+
+pub struct LatencyTimer<'a> {
+    histogram: &'a LatencyHistogram,
+    start: Instant,
+}
+
+impl Drop for LatencyTimer<'_> {
+    fn drop(&mut self) {
+        self.histogram.record(self.start.elapsed());
+    }
+}
+
+/// Process wide counters of the FFI layer, every field only grows until lance_reset_metrics
+pub struct Metrics {
+    pub create_latency: LatencyHistogram,
+    pub write_latency: LatencyHistogram,
+    pub scan_latency: LatencyHistogram,
+    /// Rows and bytes imported from C streams
+    pub rows_written: AtomicU64,
+    pub bytes_written: AtomicU64,
+    /// Rows and bytes exported to C streams
+    pub rows_read: AtomicU64,
+    pub bytes_read: AtomicU64,
+    pub fragments_created: AtomicU64,
+    /// Requests issued to the object store, a local dataset counts one per file access
+    pub read_requests: AtomicU64,
+    pub write_requests: AtomicU64,
+}
+
+pub static METRICS: Metrics = Metrics {
+    create_latency: LatencyHistogram::new(),
+    write_latency: LatencyHistogram::new(),
+    scan_latency: LatencyHistogram::new(),
+    rows_written: ZERO,
+    bytes_written: ZERO,
+    rows_read: ZERO,
+    bytes_read: ZERO,
+    fragments_created: ZERO,
+    read_requests: ZERO,
+    write_requests: ZERO,
+};
+
+/// C representation of LatencyHistogram, see LanceLatencyHistogram in lance_ffi.h
+#[repr(C)]
+pub struct LanceLatencyHistogram {
+    pub count: u64,
+    pub sum_us: u64,
+    pub max_us: u64,
+    pub buckets: [u64; LATENCY_BUCKETS],
+}
+
+/// C representation of Metrics, see LanceMetrics in lance_ffi.h
+#[repr(C)]
+pub struct LanceMetrics {
+    pub create_latency: LanceLatencyHistogram,
+    pub write_latency: LanceLatencyHistogram,
+    pub scan_latency: LanceLatencyHistogram,
+    pub rows_written: u64,
+    pub bytes_written: u64,
+    pub rows_read: u64,
+    pub bytes_read: u64,
+    pub fragments_created: u64,
+    pub read_requests: u64,
+    pub write_requests: u64,
+}
+
+/// Which side of the C boundary a CountingReader reports to
+#[derive(Clone, Copy)]
+pub enum Direction {
+    /// Batches imported from C
+    Import,
+    /// Batches exported to C
+    Export,
+}
+
+/// RecordBatchReader counting the rows and bytes passing through it
+pub struct CountingReader<R> {
+    inner: R,
+    direction: Direction,
+}
+
+impl<R: RecordBatchReader> CountingReader<R> {
+    pub fn new(inner: R, direction: Direction) -> Self {
+        Self { inner, direction }
+    }
+}
+
+impl<R: RecordBatchReader> Iterator for CountingReader<R> {
+    type Item = Result<RecordBatch, ArrowError>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        let item = self.inner.next();
+        if let Some(Ok(batch)) = &item {
+            record_batch(batch, self.direction);
+        }
+        item
+    }
+}
+
+impl<R: RecordBatchReader> RecordBatchReader for CountingReader<R> {
+    fn schema(&self) -> SchemaRef {
+        self.inner.schema()
+    }
+}
+
+/// Count a batch crossing the C boundary
+pub fn record_batch(batch: &RecordBatch, direction: Direction) {
+    let (rows, bytes) = match direction {
+        Direction::Import => (&METRICS.rows_written, &METRICS.bytes_written),
+        Direction::Export => (&METRICS.rows_read, &METRICS.bytes_read),
+    };
+    rows.fetch_add(batch.num_rows() as u64, Ordering::Relaxed);
+    bytes.fetch_add(batch.get_array_memory_size() as u64, Ordering::Relaxed);
+}
+
+/// Object store wrapper installed on every dataset to count the requests Lance issues
+#[derive(Debug)]
+pub struct IoRequestCounter;
+
+impl WrappingObjectStore for IoRequestCounter {
+    fn wrap(&self, original: Arc<dyn ObjectStore>) -> Arc<dyn ObjectStore> {
+        Arc::new(CountingObjectStore { inner: original })
+    }
+}
+
+#[derive(Debug)]
+struct CountingObjectStore {
+    inner: Arc<dyn ObjectStore>,
+}
+
+impl std::fmt::Display for CountingObjectStore {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        write!(f, "CountingObjectStore({})", self.inner)
+    }
+}
+
+fn count_read() {
+    METRICS.read_requests.fetch_add(1, Ordering::Relaxed);
+}
+
+fn count_write() {
+    METRICS.write_requests.fetch_add(1, Ordering::Relaxed);
+}
+
+// Every method is forwarded, so the optimized implementations of the inner store are kept
+#[async_trait]
+impl ObjectStore for CountingObjectStore {
+    async fn put_opts(
+        &self,
+        location: &Path,
+        payload: PutPayload,
+        opts: PutOptions,
+    ) -> object_store::Result<PutResult> {
+        count_write();
+        self.inner.put_opts(location, payload, opts).await
+    }
+
+    async fn put_multipart_opts(
+        &self,
+        location: &Path,
+        opts: PutMultipartOpts,
+    ) -> object_store::Result<Box<dyn MultipartUpload>> {
+        count_write();
+        self.inner.put_multipart_opts(location, opts).await
+    }
+
+    async fn get_opts(
+        &self,
+        location: &Path,
+        options: GetOptions,
+    ) -> object_store::Result<GetResult> {
+        count_read();
+        self.inner.get_opts(location, options).await
+    }
+
+    async fn get_range(&self, location: &Path, range: Range<usize>) -> object_store::Result<Bytes> {
+        count_read();
+        self.inner.get_range(location, range).await
+    }
+
+    async fn get_ranges(
+        &self,
+        location: &Path,
+        ranges: &[Range<usize>],
+    ) -> object_store::Result<Vec<Bytes>> {
+        count_read();
+        self.inner.get_ranges(location, ranges).await
+    }
+
+    async fn head(&self, location: &Path) -> object_store::Result<ObjectMeta> {
+        count_read();
+        self.inner.head(location).await
+    }
+
+    async fn delete(&self, location: &Path) -> object_store::Result<()> {
+        count_write();
+        self.inner.delete(location).await
+    }
+
+    fn list(&self, prefix: Option<&Path>) -> BoxStream<'_, object_store::Result<ObjectMeta>> {
+        count_read();
+        self.inner.list(prefix)
+    }
+
+    async fn list_with_delimiter(&self, prefix: Option<&Path>) -> object_store::Result<ListResult> {
+        count_read();
+        self.inner.list_with_delimiter(prefix).await
+    }
+
+    async fn copy(&self, from: &Path, to: &Path) -> object_store::Result<()> {
+        count_write();
+        self.inner.copy(from, to).await
+    }
+
+    async fn copy_if_not_exists(&self, from: &Path, to: &Path) -> object_store::Result<()> {
+        count_write();
+        self.inner.copy_if_not_exists(from, to).await
+    }
+
+    async fn rename(&self, from: &Path, to: &Path) -> object_store::Result<()> {
+        count_write();
+        self.inner.rename(from, to).await
+    }
+
+    async fn rename_if_not_exists(&self, from: &Path, to: &Path) -> object_store::Result<()> {
+        count_write();
+        self.inner.rename_if_not_exists(from, to).await
+    }
+}
+
+/// Copy the current metrics into the caller's struct
+#[no_mangle]
+pub extern "C" fn lance_get_metrics(metrics: *mut LanceMetrics) {
+    let snapshot = LanceMetrics {
+        create_latency: METRICS.create_latency.snapshot(),
+        write_latency: METRICS.write_latency.snapshot(),
+        scan_latency: METRICS.scan_latency.snapshot(),
+        rows_written: METRICS.rows_written.load(Ordering::Relaxed),
+        bytes_written: METRICS.bytes_written.load(Ordering::Relaxed),
+        rows_read: METRICS.rows_read.load(Ordering::Relaxed),
+        bytes_read: METRICS.bytes_read.load(Ordering::Relaxed),
+        fragments_created: METRICS.fragments_created.load(Ordering::Relaxed),
+        read_requests: METRICS.read_requests.load(Ordering::Relaxed),
+        write_requests: METRICS.write_requests.load(Ordering::Relaxed),
+    };
+    unsafe {
+        std::ptr::write(metrics, snapshot);
+    }
+}
+
+/// Reset every counter and histogram to zero
+#[no_mangle]
+pub extern "C" fn lance_reset_metrics() {
+    METRICS.create_latency.reset();
+    METRICS.write_latency.reset();
+    METRICS.scan_latency.reset();
+    for counter in [
+        &METRICS.rows_written,
+        &METRICS.bytes_written,
+        &METRICS.rows_read,
+        &METRICS.bytes_read,
+        &METRICS.fragments_created,
+        &METRICS.read_requests,
+        &METRICS.write_requests,
+    ] {
+        counter.store(0, Ordering::Relaxed);
+    }
+}
@@ -0,0 +1,56 @@
+use arrow::{
+    datatypes::SchemaRef,
+    error::ArrowError,
+    record_batch::{RecordBatch, RecordBatchReader},
+};
+use futures::StreamExt;
+use lance::dataset::scanner::DatasetRecordBatchStream;
+use tokio::runtime::Runtime;
+use tokio::sync::mpsc;
+
+/// Default number of batches decoded ahead of the consumer
+pub const DEFAULT_PREFETCH_BATCHES: usize = 2;
+
+/// RecordBatchReader over a Lance scan stream. The scan is driven by a runtime task which stays at most
+/// `prefetch` batches ahead of the consumer, so memory is bounded regardless of the table size.
+/// next() blocks the calling thread, it must not be called from within the runtime.
+pub struct PrefetchRecordBatchReader {
+    schema: SchemaRef,
+    rx: mpsc::Receiver<Result<RecordBatch, ArrowError>>,
+}
+
+impl PrefetchRecordBatchReader {
+    pub fn spawn(
+        rt: &Runtime,
+        schema: SchemaRef,
+        mut stream: DatasetRecordBatchStream,
+        prefetch: usize,
+    ) -> Self {
+        let (tx, rx) = mpsc::channel(prefetch.max(1));
+        rt.spawn(async move {
+            while let Some(item) = stream.next().await {
+                let item = item.map_err(|e| ArrowError::ExternalError(Box::new(e)));
+                let is_err = item.is_err();
+                // Stop scanning once the consumer released the stream
+                if tx.send(item).await.is_err() || is_err {
+                    break;
+                }
+            }
+        });
+        Self { schema, rx }
+    }
+}
+
+impl Iterator for PrefetchRecordBatchReader {
+    type Item = Result<RecordBatch, ArrowError>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        self.rx.blocking_recv()
+    }
+}
+
+impl RecordBatchReader for PrefetchRecordBatchReader {
+    fn schema(&self) -> SchemaRef {
+        self.schema.clone()
+    }
+}
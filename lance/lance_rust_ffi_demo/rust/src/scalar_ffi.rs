@@ -0,0 +1,162 @@
+use crate::ffi::{
+    default_scan_options, export_arrow_stream, LanceScanOptions, LanceTable, RUNTIME,
+};
+use crate::metrics::METRICS;
+use crate::prefetch_reader::{PrefetchRecordBatchReader, DEFAULT_PREFETCH_BATCHES};
+use arrow::{ffi_stream::FFI_ArrowArrayStream, record_batch::RecordBatchIterator};
+use lance_index::IndexType;
+use std::ffi::CStr;
+use std::os::raw::{c_char, c_int};
+
+/// Build a scalar index on a column, index_type is 0 for BTree and 1 for Bitmap
+#[no_mangle]
+pub extern "C" fn lance_table_create_scalar_index(
+    table: *const LanceTable,
+    column: *const c_char,
+    index_type: c_int,
+    replace: bool,
+) -> c_int {
+    let rt = RUNTIME.get().unwrap();
+    let table = unsafe { &*table };
+    let column_str = unsafe { CStr::from_ptr(column).to_str().unwrap() };
+    let index_type = match index_type {
+        0 => IndexType::BTree,
+        1 => IndexType::Bitmap,
+        _ => {
+            println!("[rust]: Unsupported scalar index type: {}", index_type);
+            return 1;
+        }
+    };
+
+    let mut manager_guard = table.manager.blocking_write();
+
+    match rt.block_on(manager_guard.create_scalar_index(column_str, index_type, replace)) {
+        Ok(_) => 0,
+        Err(e) => {
+            println!(
+                "[rust]: Failed to build scalar index on table '{}': {}",
+                table.name, e
+            );
+            1
+        }
+    }
+}
+
+/// Fetch rows by row id, the rows are returned in the order of row_ids as a single batch
+#[no_mangle]
+pub extern "C" fn lance_table_take_rows(
+    table: *const LanceTable,
+    row_ids: *const u64,
+    num_row_ids: usize,
+    columns: *const *const c_char,
+    num_columns: usize,
+    stream_addr: *mut FFI_ArrowArrayStream,
+) -> c_int {
+    let _timer = METRICS.scan_latency.start();
+    let rt = RUNTIME.get().unwrap();
+    let table = unsafe { &*table };
+    let row_ids: &[u64] = if num_row_ids == 0 {
+        &[]
+    } else if row_ids.is_null() {
+        println!("[rust]: row_ids is NULL but num_row_ids is {}", num_row_ids);
+        return 1;
+    } else {
+        unsafe { std::slice::from_raw_parts(row_ids, num_row_ids) }
+    };
+    let columns: Option<Vec<String>> = if columns.is_null() {
+        None
+    } else {
+        let mut names = Vec::with_capacity(num_columns);
+        for i in 0..num_columns {
+            match unsafe { CStr::from_ptr(*columns.add(i)) }.to_str() {
+                Ok(name) => names.push(name.to_string()),
+                Err(e) => {
+                    println!("[rust]: Invalid column name: {}", e);
+                    return 1;
+                }
+            }
+        }
+        Some(names)
+    };
+
+    let take_result = {
+        let manager_guard = table.manager.blocking_read();
+        rt.block_on(manager_guard.take_rows(row_ids, columns.as_deref()))
+    };
+
+    match take_result {
+        Ok(batch) => {
+            let schema = batch.schema();
+            let batch_iter = RecordBatchIterator::new(vec![Ok(batch)], schema);
+            export_arrow_stream(batch_iter, stream_addr);
+            0
+        }
+        Err(e) => {
+            println!(
+                "[rust]: Failed to take rows from table '{}': {}",
+                table.name, e
+            );
+            1
+        }
+    }
+}
+
+/// Fetch rows whose integer key column matches one of keys, answered by the scalar index of the
+/// column if there is one. options may add a projection and an extra filter
+#[no_mangle]
+pub extern "C" fn lance_table_take_by_keys(
+    table: *const LanceTable,
+    column: *const c_char,
+    keys: *const i64,
+    num_keys: usize,
+    options: *const LanceScanOptions,
+    stream_addr: *mut FFI_ArrowArrayStream,
+) -> c_int {
+    let _timer = METRICS.scan_latency.start();
+    let rt = RUNTIME.get().unwrap();
+    let table = unsafe { &*table };
+    let column_str = unsafe { CStr::from_ptr(column).to_str().unwrap() };
+    let keys: &[i64] = if num_keys == 0 {
+        &[]
+    } else if keys.is_null() {
+        println!("[rust]: keys is NULL but num_keys is {}", num_keys);
+        return 1;
+    } else {
+        unsafe { std::slice::from_raw_parts(keys, num_keys) }
+    };
+
+    let scan_options = if options.is_null() {
+        default_scan_options()
+    } else {
+        match unsafe { (*options).to_scan_options() } {
+            Ok(scan_options) => scan_options,
+            Err(e) => {
+                println!("[rust]: Invalid scan options: {}", e);
+                return 1;
+            }
+        }
+    };
+
+    let scan_result = {
+        let manager_guard = table.manager.blocking_read();
+        rt.block_on(manager_guard.take_by_keys(column_str, keys, &scan_options))
+    };
+
+    match scan_result {
+        Ok((schema, stream)) => {
+            let prefetch = scan_options
+                .batch_readahead
+                .unwrap_or(DEFAULT_PREFETCH_BATCHES);
+            let reader = PrefetchRecordBatchReader::spawn(rt, schema, stream, prefetch);
+            export_arrow_stream(reader, stream_addr);
+            0
+        }
+        Err(e) => {
+            println!(
+                "[rust]: Failed to take rows from table '{}': {}",
+                table.name, e
+            );
+            1
+        }
+    }
+}
@@ -0,0 +1,161 @@
+use crate::ffi::{
+    default_scan_options, export_arrow_stream, LanceScanOptions, LanceTable, RUNTIME,
+};
+use crate::metrics::METRICS;
+use crate::prefetch_reader::{PrefetchRecordBatchReader, DEFAULT_PREFETCH_BATCHES};
+use crate::{VectorIndexOptions, VectorQuery};
+use arrow::ffi_stream::FFI_ArrowArrayStream;
+use lance_linalg::distance::DistanceType;
+use std::ffi::CStr;
+use std::os::raw::{c_char, c_int};
+
+fn to_distance_type(metric: c_int) -> Option<DistanceType> {
+    match metric {
+        0 => Some(DistanceType::L2),
+        1 => Some(DistanceType::Cosine),
+        2 => Some(DistanceType::Dot),
+        _ => None,
+    }
+}
+
+/// C representation of VectorIndexOptions, see LanceVectorIndexOptions in lance_ffi.h
+#[repr(C)]
+pub struct LanceVectorIndexOptions {
+    pub column: *const c_char,
+    pub metric: c_int,
+    pub num_partitions: c_int,
+    pub num_sub_vectors: c_int,
+    pub num_bits: c_int,
+    pub max_iterations: c_int,
+    pub replace: bool,
+}
+
+/// C representation of VectorQuery, see LanceVectorQuery in lance_ffi.h
+#[repr(C)]
+pub struct LanceVectorQuery {
+    pub column: *const c_char,
+    pub vector: *const f32,
+    pub dim: usize,
+    pub k: i64,
+    pub metric: c_int,
+    pub nprobes: c_int,
+    pub refine_factor: c_int,
+    pub prefilter: bool,
+    pub use_index: bool,
+    pub scan: *const LanceScanOptions,
+}
+
+/// Build an IVF_PQ index on a fixed size list of float32 column
+#[no_mangle]
+pub extern "C" fn lance_table_create_vector_index(
+    table: *const LanceTable,
+    options: *const LanceVectorIndexOptions,
+) -> c_int {
+    let rt = RUNTIME.get().unwrap();
+    let table = unsafe { &*table };
+    let options = unsafe { &*options };
+
+    let column = unsafe { CStr::from_ptr(options.column).to_str().unwrap() };
+    let distance_type = match to_distance_type(options.metric) {
+        Some(distance_type) => distance_type,
+        None => {
+            println!("[rust]: Unsupported metric: {}", options.metric);
+            return 1;
+        }
+    };
+    let index_options = VectorIndexOptions {
+        column: column.to_string(),
+        distance_type,
+        num_partitions: options.num_partitions.max(1) as usize,
+        num_sub_vectors: options.num_sub_vectors.max(1) as usize,
+        num_bits: if options.num_bits > 0 {
+            options.num_bits as u8
+        } else {
+            8
+        },
+        max_iterations: if options.max_iterations > 0 {
+            options.max_iterations as usize
+        } else {
+            50
+        },
+        replace: options.replace,
+    };
+
+    let mut manager_guard = table.manager.blocking_write();
+
+    match rt.block_on(manager_guard.create_vector_index(&index_options)) {
+        Ok(_) => 0,
+        Err(e) => {
+            println!(
+                "[rust]: Failed to build vector index on table '{}': {}",
+                table.name, e
+            );
+            1
+        }
+    }
+}
+
+/// Top-k nearest neighbour search, results are streamed through stream_addr
+#[no_mangle]
+pub extern "C" fn lance_table_vector_search(
+    table: *const LanceTable,
+    query: *const LanceVectorQuery,
+    stream_addr: *mut FFI_ArrowArrayStream,
+) -> c_int {
+    let _timer = METRICS.scan_latency.start();
+    let rt = RUNTIME.get().unwrap();
+    let table = unsafe { &*table };
+    let query = unsafe { &*query };
+
+    let column = unsafe { CStr::from_ptr(query.column).to_str().unwrap() };
+    let distance_type = match to_distance_type(query.metric) {
+        Some(distance_type) => distance_type,
+        None => {
+            println!("[rust]: Unsupported metric: {}", query.metric);
+            return 1;
+        }
+    };
+    let scan_options = if query.scan.is_null() {
+        default_scan_options()
+    } else {
+        match unsafe { (*query.scan).to_scan_options() } {
+            Ok(scan_options) => scan_options,
+            Err(e) => {
+                println!("[rust]: Invalid scan options: {}", e);
+                return 1;
+            }
+        }
+    };
+    let vector_query = VectorQuery {
+        column: column.to_string(),
+        vector: unsafe { std::slice::from_raw_parts(query.vector, query.dim) }.to_vec(),
+        k: query.k.max(1) as usize,
+        distance_type,
+        nprobes: (query.nprobes > 0).then_some(query.nprobes as usize),
+        refine_factor: (query.refine_factor > 0).then_some(query.refine_factor as u32),
+        prefilter: query.prefilter,
+        use_index: query.use_index,
+        scan: scan_options,
+    };
+
+    let search_result = {
+        let manager_guard = table.manager.blocking_read();
+        rt.block_on(manager_guard.vector_search(&vector_query))
+    };
+
+    match search_result {
+        Ok((schema, stream)) => {
+            let prefetch = vector_query
+                .scan
+                .batch_readahead
+                .unwrap_or(DEFAULT_PREFETCH_BATCHES);
+            let reader = PrefetchRecordBatchReader::spawn(rt, schema, stream, prefetch);
+            export_arrow_stream(reader, stream_addr);
+            0
+        }
+        Err(e) => {
+            println!("[rust]: Failed to search table '{}': {}", table.name, e);
+            1
+        }
+    }
+}
@@ -0,0 +1,147 @@
+use anyhow::Result;
+use arrow::{datatypes::SchemaRef, record_batch::RecordBatch};
+use std::time::{Duration, Instant};
+
+/// Thresholds of a WriteBuffer, whichever is reached first triggers a flush
+#[derive(Debug, Clone)]
+pub struct WriteBufferOptions {
+    pub max_rows: usize,
+    pub max_bytes: usize,
+    /// Max time the oldest buffered batch waits before being committed
+    pub max_delay: Duration,
+}
+
+impl Default for WriteBufferOptions {
+    fn default() -> Self {
+        Self {
+            max_rows: 100_000,
+            max_bytes: 64 * 1024 * 1024,
+            max_delay: Duration::from_secs(1),
+        }
+    }
+}
+
+/// A buffered batch and when it was appended
+#[derive(Debug)]
+struct BufferedBatch {
+    batch: RecordBatch,
+    bytes: usize,
+    enqueued: Instant,
+}
+
+/// Coalesces small appends in memory, so that a trickle of tiny batches is committed as
+/// a few large fragments instead of one fragment per append
+#[derive(Debug, Default)]
+pub struct WriteBuffer {
+    options: WriteBufferOptions,
+    schema: Option<SchemaRef>,
+    batches: Vec<BufferedBatch>,
+    rows: usize,
+    bytes: usize,
+}
+
+impl WriteBuffer {
+    pub fn new(options: WriteBufferOptions) -> Self {
+        Self {
+            options,
+            ..Self::default()
+        }
+    }
+
+    pub fn options(&self) -> &WriteBufferOptions {
+        &self.options
+    }
+
+    pub fn set_options(&mut self, options: WriteBufferOptions) {
+        self.options = options;
+    }
+
+    /// Append all batches or, if one of them does not match the buffered schema, none of them
+    pub fn push_all(&mut self, batches: Vec<RecordBatch>) -> Result<()> {
+        let buffered = self
+            .schema
+            .clone()
+            .or_else(|| batches.first().map(|batch| batch.schema()));
+        if let Some(schema) = &buffered {
+            for batch in &batches {
+                Self::check_schema(schema, batch)?;
+            }
+        }
+        for batch in batches {
+            self.push(batch)?;
+        }
+        Ok(())
+    }
+
+    pub fn push(&mut self, batch: RecordBatch) -> Result<()> {
+        match &self.schema {
+            Some(schema) => Self::check_schema(schema, &batch)?,
+            None => self.schema = Some(batch.schema()),
+        }
+        if batch.num_rows() == 0 {
+            return Ok(());
+        }
+        let bytes = batch.get_array_memory_size();
+        self.rows += batch.num_rows();
+        self.bytes += bytes;
+        self.batches.push(BufferedBatch {
+            batch,
+            bytes,
+            enqueued: Instant::now(),
+        });
+        Ok(())
+    }
+
+    pub fn should_flush(&self) -> bool {
+        self.rows >= self.options.max_rows
+            || self.bytes >= self.options.max_bytes
+            || self.is_expired()
+    }
+
+    pub fn is_expired(&self) -> bool {
+        self.batches
+            .first()
+            .map(|oldest| oldest.enqueued.elapsed() >= self.options.max_delay)
+            .unwrap_or(false)
+    }
+
+    /// The buffered batches to commit, None if the buffer is empty. They stay buffered until consume
+    /// is called after a successful commit, so that a failed commit loses nothing
+    pub fn snapshot(&mut self) -> Option<(SchemaRef, Vec<RecordBatch>)> {
+        if self.batches.is_empty() {
+            // Only empty batches were appended, nothing to commit
+            self.schema = None;
+            return None;
+        }
+        let batches = self
+            .batches
+            .iter()
+            .map(|buffered| buffered.batch.clone())
+            .collect();
+        Some((self.schema.clone().unwrap(), batches))
+    }
+
+    /// Drop the first num_batches batches of the buffer, which were committed. Once the buffer is empty
+    /// the schema is forgotten as well, so that the next appends may follow a schema change of the
+    /// table, e.g. by an overwrite
+    pub fn consume(&mut self, num_batches: usize) {
+        for buffered in self.batches.drain(..num_batches) {
+            self.rows -= buffered.batch.num_rows();
+            self.bytes -= buffered.bytes;
+        }
+        if self.batches.is_empty() {
+            self.schema = None;
+        }
+    }
+
+    fn check_schema(schema: &SchemaRef, batch: &RecordBatch) -> Result<()> {
+        if schema != &batch.schema() {
+            return Err(anyhow::anyhow!(
+                "Schema mismatch, buffered: {}, appended: {}",
+                schema,
+                batch.schema()
+            ));
+        }
+        Ok(())
+    }
+}
@@ -106,6 +106,20 @@ public:
    */
     uint32_t read(uint8_t* buf, uint32_t len);
 
+    /**
+   * Lets the protocol read straight from the current frame. Returns nullptr if fewer
+   * than len bytes are left in it, otherwise sets len to the number of bytes left.
+   * The pointer is valid until the next read, borrow or consume.
+   */
+    const uint8_t* borrow(uint8_t* buf, uint32_t* len);
+
+    /**
+   * Marks len bytes of the current frame, obtained with borrow(), as read.
+   *
+   * @throws TTransportException if fewer than len bytes are left
+   */
+    void consume(uint32_t len);
+
     /**
    * Writes the string in its entirety to the buffer.
    *
@@ -121,8 +135,8 @@ public:
     void write(const uint8_t* buf, uint32_t len);
 
     /**
-   * Flushes any pending data to be written. Typically used with buffered
-   * transport mechanisms.
+   * Flushes any pending data to be written. Everything written since the last
+   * flush goes out as a single frame, wrapped once if QOP requires it.
    *
    * @throws TTransportException if an error occurs
    */
@@ -151,8 +165,17 @@ protected:
     /// Underlying transport
     std::shared_ptr<TTransport> transport_;
 
-    /// Buffer for reading and writing.
-    TMemoryBuffer* memBuf_;
+    /// Reusable buffer receiving the frames which are not read in place by the caller.
+    boost::scoped_array<uint8_t> frameBuf_;
+    uint32_t frameBufCapacity_;
+
+    /// Current frame: points to frameBuf_, or to the unwrap buffer of sasl_ which stays
+    /// valid until the next unwrap, i.e. until the next frame is read.
+    const uint8_t* frame_;
+    uint32_t frameLength_;
+
+    /// Number of bytes of the current frame already read.
+    uint32_t framePos_;
 
     /// Sasl implementation class. This is passed in to the transport constructor
     /// initialized for either a client or a server.
@@ -164,8 +187,15 @@ protected:
     /// True if this is a client.
     bool isClient_;
 
-    /// Buffer to hold protocol info.
+    /// Frame being written: room for the length prefix, followed by the data written
+    /// since the last flush. Also holds the outgoing messages of the negotiation.
+    boost::scoped_array<uint8_t> writeBuf_;
+    uint32_t writeBufCapacity_;
+    uint32_t writeBufLength_;
+
+    /// Buffer to hold protocol info, reused across messages.
     boost::scoped_array<uint8_t> protoBuf_;
+    uint32_t protoBufCapacity_;
 
     /* store the big endian format int to given buffer */
     static void encodeInt(uint32_t x, uint8_t* buf, uint32_t offset) {
@@ -220,18 +250,20 @@ protected:
     uint32_t readLength();
 
     /**
-   * Write the given integer as 4 bytes to the underlying transport.
-   *
-   * @param length
-   *          The length prefix of the next SASL message to write.
-   * @throws TTransportException
-   *           Thrown if writing to the underlying transport fails.
+   * Grow writeBuf_ to hold at least size bytes, keeping its content.
    */
-    void writeLength(uint32_t length);
+    void reserveWriteBuffer(uint32_t size);
+
     virtual void handleSaslStartMessage() = 0;
 
-    /// If memBuf_ is filled with bytes that are already read, and has crossed a size
-    /// threshold (see implementation for exact value), resize the buffer to a default value.
+    /**
+   * Read a frame of the given length from the underlying transport and make it the
+   * current frame, unwrapped if QOP requires it.
+   */
+    void readFrame(uint32_t length);
+
+    /// If the current frame is fully read, and frameBuf_ has crossed a size threshold
+    /// (see implementation for exact value), release the buffer.
     void shrinkBuffer();
 };
 
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <thrift/transport/TTransport.h>
+#include <thrift/transport/TTransportException.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "ThriftHiveMetastore.h"
+
+struct HiveMetastoreClientPoolOptions {
+    std::string host;
+    int port = 9083;
+    // Kerberos principal of the metastore, e.g. hive/metastore.example.com@EXAMPLE.COM. Empty to connect without SASL
+    std::string principal;
+    // Max number of connections, borrowed or idle
+    size_t max_size = 8;
+    // Number of idle connections negotiated ahead of time, first by the constructor and then in the background each
+    // time borrowing takes the pool below it, so that borrowing does not wait
+    size_t min_idle = 1;
+    // Idle connections are closed after this long
+    std::chrono::milliseconds idle_timeout = std::chrono::minutes(5);
+    // Connections are closed, and negotiated again, after this long. Keep it below the ticket lifetime
+    std::chrono::milliseconds max_lifetime = std::chrono::hours(1);
+    // A connection idle for longer is checked with a cheap call before it is lent
+    std::chrono::milliseconds validation_interval = std::chrono::seconds(30);
+    // borrow() fails if no connection becomes available within this time
+    std::chrono::milliseconds borrow_timeout = std::chrono::seconds(10);
+    int connect_timeout_ms = 5000;
+    int socket_timeout_ms = 60000;
+    // Called when the SASL negotiation fails, e.g. to kinit from a keytab once the ticket expired. The negotiation
+    // is retried once afterwards
+    std::function<void()> refresh_credentials;
+};
+
+// Thread-safe pool of authenticated metastore clients. The Kerberos negotiation, several round-trips and a KDC
+// request, is paid once per connection instead of once per use.
+class HiveMetastoreClientPool {
+    struct Connection {
+        std::shared_ptr<apache::thrift::transport::TTransport> transport;
+        std::unique_ptr<Apache::Hadoop::Hive::ThriftHiveMetastoreClient> client;
+        std::chrono::steady_clock::time_point created;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+public:
+    // A client lent by the pool, given back when the lease is destroyed
+    class Lease {
+    public:
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease();
+
+        Apache::Hadoop::Hive::ThriftHiveMetastoreClient& client() const { return *_connection->client; }
+
+        Apache::Hadoop::Hive::ThriftHiveMetastoreClient* operator->() const { return _connection->client.get(); }
+
+        // Close the connection instead of giving it back, e.g. when a transport error left it in an unknown state
+        void invalidate() { _broken = true; }
+
+    private:
+        friend class HiveMetastoreClientPool;
+
+        Lease(HiveMetastoreClientPool* pool, std::unique_ptr<Connection> connection)
+                : _pool(pool), _connection(std::move(connection)) {}
+
+        HiveMetastoreClientPool* _pool;
+        std::unique_ptr<Connection> _connection;
+        bool _broken = false;
+    };
+
+    // Negotiates min_idle connections before returning. Failing to connect is logged, and retried in the background
+    explicit HiveMetastoreClientPool(HiveMetastoreClientPoolOptions options);
+
+    // Every lease must be destroyed before the pool
+    ~HiveMetastoreClientPool();
+
+    // Lend an idle client, or connect a new one if the pool is not full.
+    // @throws TTransportException if none is available within borrow_timeout, or connecting failed
+    Lease borrow();
+
+    // Run fn(client) with a borrowed client. A transport error closes the connection and fn is retried once on
+    // another one, so fn must be idempotent, as the read calls of a planner are
+    template <typename Fn>
+    auto call(Fn&& fn) {
+        for (int attempt = 0;; attempt++) {
+            Lease lease = borrow();
+            try {
+                return fn(lease.client());
+            } catch (const apache::thrift::transport::TTransportException&) {
+                lease.invalidate();
+                if (attempt > 0) {
+                    throw;
+                }
+            }
+        }
+    }
+
+    // Number of connections, borrowed or idle
+    size_t size() const;
+
+    size_t idle_size() const;
+
+private:
+    std::unique_ptr<Connection> connect();
+    std::unique_ptr<Connection> negotiate();
+    bool is_usable(Connection& connection);
+    void release(std::unique_ptr<Connection> connection, bool broken);
+    static void close(Connection& connection);
+
+    // Whether fewer than min_idle connections are idle and the pool has room for more. Requires _mutex
+    bool needs_replenish() const;
+    // Connect until min_idle connections are idle, unlocking during each negotiation. Returns false on a failure
+    bool replenish(std::unique_lock<std::mutex>& lock);
+
+    // Body of _maintainer: evicts idle and expired connections and keeps min_idle ones ready. It runs every half
+    // idle_timeout or max_lifetime, and as soon as _maintainer_wakeup is notified
+    void maintain();
+
+    const HiveMetastoreClientPoolOptions _options;
+    std::string _sasl_service;
+    std::string _sasl_fqdn;
+    // Serializes refresh_credentials
+    std::mutex _refresh_mutex;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _available;
+    // Notified on shutdown, and when borrowing or dropping a connection takes the pool below min_idle
+    std::condition_variable _maintainer_wakeup;
+    // The most recently used connections are at the back
+    std::deque<std::unique_ptr<Connection>> _idle;
+    size_t _size = 0;
+    bool _stopping = false;
+    std::thread _maintainer;
+};
@@ -22,35 +22,59 @@
 
 #include <thrift/transport/TBufferTransports.h>
 
+#include <algorithm>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <cstdint>
+#include <cstring>
 #include <sstream>
 
-// Default size, in bytes, for the memory buffer used to stage reads.
-const int32_t DEFAULT_MEM_BUF_SIZE = 32 * 1024;
+// Minimum size, in bytes, of the buffers receiving frames and SASL messages.
+const uint32_t DEFAULT_BUF_SIZE = 32 * 1024;
+
+// Frame buffers larger than this, in bytes, are released once their frame is read.
+const uint32_t MAX_RETAINED_BUF_SIZE = 4 * 1024 * 1024;
 
 namespace apache::thrift::transport {
 
+// Grow buf to hold at least size bytes, its content is not preserved.
+static uint8_t* reserveBuffer(boost::scoped_array<uint8_t>& buf, uint32_t& capacity, uint32_t size) {
+    if (size > capacity) {
+        capacity = std::max(size, DEFAULT_BUF_SIZE);
+        buf.reset(new uint8_t[capacity]);
+    }
+    return buf.get();
+}
+
 TSaslTransport::TSaslTransport(std::shared_ptr<TTransport> transport)
         : TVirtualTransport(transport->getConfiguration()),
           transport_(std::move(transport)),
-          memBuf_(new TMemoryBuffer(DEFAULT_MEM_BUF_SIZE, transport_->getConfiguration())),
+          frameBufCapacity_(0),
+          frame_(nullptr),
+          frameLength_(0),
+          framePos_(0),
           sasl_(nullptr),
           shouldWrap_(false),
-          isClient_(false) {}
+          isClient_(false),
+          writeBufCapacity_(0),
+          writeBufLength_(PAYLOAD_LENGTH_BYTES),
+          protoBufCapacity_(0) {}
 
 TSaslTransport::TSaslTransport(std::shared_ptr<sasl::TSasl> saslClient, std::shared_ptr<TTransport> transport)
         : TVirtualTransport(transport->getConfiguration()),
           transport_(std::move(transport)),
-          memBuf_(new TMemoryBuffer(transport_->getConfiguration())),
+          frameBufCapacity_(0),
+          frame_(nullptr),
+          frameLength_(0),
+          framePos_(0),
           sasl_(std::move(saslClient)),
           shouldWrap_(false),
-          isClient_(true) {}
+          isClient_(true),
+          writeBufCapacity_(0),
+          writeBufLength_(PAYLOAD_LENGTH_BYTES),
+          protoBufCapacity_(0) {}
 
-TSaslTransport::~TSaslTransport() {
-    delete memBuf_;
-}
+TSaslTransport::~TSaslTransport() = default;
 
 bool TSaslTransport::isOpen() const {
     return transport_->isOpen();
@@ -111,12 +135,12 @@ void TSaslTransport::doSaslNegotiation() {
                 throw TTransportException(ss.str());
             }
         }
-    } catch (const TException& e) {
+    } catch (const TException&) {
         // If we hit an exception, that means the Sasl negotiation failed. We explicitly
         // reset the negotiation state here since the caller may retry an open() which would
         // start a new connection negotiation.
         resetSaslNegotiationState();
-        throw e;
+        throw;
     }
 }
 
@@ -146,99 +170,121 @@ uint32_t TSaslTransport::readLength() {
 }
 
 void TSaslTransport::shrinkBuffer() {
-    // readEnd() returns the number of bytes already read, i.e. the number of 'junk' bytes
-    // taking up space at the front of the memory buffer.
-    uint32_t read_end = memBuf_->readEnd();
-
-    // If the size of the junk space at the beginning of the buffer is too large, and
-    // there's no data left in the buffer to read (number of bytes read == number of bytes
-    // written), then shrink the buffer back to the default. We don't want to do this on
-    // every read that exhausts the buffer, since the layer above often reads in small
-    // chunks, which is why we only resize if there's too much junk. The write and read
-    // pointers will eventually catch up after every RPC, so we will always take this path
-    // eventually once the buffer becomes sufficiently full.
-    //
-    // readEnd() may reset the write / read pointers (but only once if there's no
-    // intervening read or write between calls), so needs to be called a second time to
-    // get their current position.
-    if (read_end > DEFAULT_MEM_BUF_SIZE && memBuf_->writeEnd() == memBuf_->readEnd()) {
-        memBuf_->resetBuffer(DEFAULT_MEM_BUF_SIZE);
+    // Frames of the usual size keep reusing the buffer, but a single huge response, e.g. thousands
+    // of partitions, should not pin its memory for the lifetime of the connection.
+    if (frameBufCapacity_ > MAX_RETAINED_BUF_SIZE && framePos_ == frameLength_) {
+        frameBuf_.reset();
+        frameBufCapacity_ = 0;
     }
 }
 
-uint32_t TSaslTransport::read(uint8_t* buf, uint32_t len) {
-    uint32_t read_bytes = memBuf_->read(buf, len);
-
-    if (read_bytes > 0) {
-        shrinkBuffer();
-        return read_bytes;
-    }
-
-    // if there's not enough data in cache, read from underlying transport
-    uint32_t dataLength = readLength();
-
-    // Fast path
-    if (len == dataLength && !shouldWrap_) {
-        transport_->readAll(buf, len);
-        return len;
-    }
-
-    auto* tmpBuf = new uint8_t[dataLength];
-    transport_->readAll(tmpBuf, dataLength);
+void TSaslTransport::readFrame(uint32_t length) {
+    uint8_t* data = reserveBuffer(frameBuf_, frameBufCapacity_, length);
+    transport_->readAll(data, length);
     if (shouldWrap_) {
-        tmpBuf = sasl_->unwrap(tmpBuf, 0, dataLength, &dataLength);
+        // Read in place from the unwrap buffer of the sasl connection instead of copying it
+        frame_ = sasl_->unwrap(data, 0, length, &length);
+    } else {
+        frame_ = data;
     }
+    frameLength_ = length;
+    framePos_ = 0;
+}
 
-    // We will consume all the data, no need to put it in the memory buffer.
-    if (len == dataLength) {
-        memcpy(buf, tmpBuf, len);
-        delete[] tmpBuf;
-        return len;
+uint32_t TSaslTransport::read(uint8_t* buf, uint32_t len) {
+    if (framePos_ == frameLength_) {
+        // if there's no data left in the current frame, read one from underlying transport
+        uint32_t dataLength = readLength();
+
+        // Fast path
+        if (len >= dataLength && !shouldWrap_) {
+            transport_->readAll(buf, dataLength);
+            return dataLength;
+        }
+        readFrame(dataLength);
     }
 
-    memBuf_->write(tmpBuf, dataLength);
-    memBuf_->flush();
-    delete[] tmpBuf;
-
-    uint32_t ret = memBuf_->read(buf, len);
+    uint32_t ret = std::min(len, frameLength_ - framePos_);
+    memcpy(buf, frame_ + framePos_, ret);
+    framePos_ += ret;
     shrinkBuffer();
     return ret;
 }
 
-void TSaslTransport::writeLength(uint32_t length) {
-    uint8_t lenBuf[PAYLOAD_LENGTH_BYTES];
-
-    encodeInt(length, lenBuf, 0);
-    transport_->write(lenBuf, PAYLOAD_LENGTH_BYTES);
+const uint8_t* TSaslTransport::borrow(uint8_t* /* buf */, uint32_t* len) {
+    // Never crosses a frame boundary, the protocol falls back to read() in that case
+    uint32_t available = frameLength_ - framePos_;
+    if (available == 0 || available < *len) {
+        return nullptr;
+    }
+    *len = available;
+    return frame_ + framePos_;
 }
 
-void TSaslTransport::write(const uint8_t* buf, uint32_t len) {
-    const uint8_t* newBuf;
+void TSaslTransport::consume(uint32_t len) {
+    if (len > frameLength_ - framePos_) {
+        throw TTransportException(TTransportException::BAD_ARGS, "consume did not follow a borrow.");
+    }
+    framePos_ += len;
+    shrinkBuffer();
+}
 
-    if (shouldWrap_) {
-        newBuf = sasl_->wrap(const_cast<uint8_t*>(buf), 0, len, &len);
-    } else {
-        newBuf = buf;
+void TSaslTransport::reserveWriteBuffer(uint32_t size) {
+    if (size <= writeBufCapacity_) {
+        return;
+    }
+    uint32_t capacity = std::max({size, writeBufCapacity_ * 2, DEFAULT_BUF_SIZE});
+    auto* buf = new uint8_t[capacity];
+    if (writeBuf_) {
+        memcpy(buf, writeBuf_.get(), writeBufLength_);
     }
-    writeLength(len);
-    transport_->write(newBuf, len);
+    writeBuf_.reset(buf);
+    writeBufCapacity_ = capacity;
+}
+
+void TSaslTransport::write(const uint8_t* buf, uint32_t len) {
+    reserveWriteBuffer(writeBufLength_ + len);
+    memcpy(writeBuf_.get() + writeBufLength_, buf, len);
+    writeBufLength_ += len;
 }
 
 void TSaslTransport::flush() {
+    uint32_t length = writeBufLength_ - PAYLOAD_LENGTH_BYTES;
+    if (length > 0) {
+        if (shouldWrap_) {
+            const uint8_t* wrapped = sasl_->wrap(writeBuf_.get(), PAYLOAD_LENGTH_BYTES, length, &length);
+            // The underlying transports have no vectored write, so the wrapped payload is copied
+            // behind the length prefix to go out in the same write
+            reserveWriteBuffer(PAYLOAD_LENGTH_BYTES + length);
+            memcpy(writeBuf_.get() + PAYLOAD_LENGTH_BYTES, wrapped, length);
+        }
+        encodeInt(length, writeBuf_.get(), 0);
+
+        // Reset the buffer before writing, so that it is in a sane state if the write throws
+        writeBufLength_ = PAYLOAD_LENGTH_BYTES;
+        transport_->write(writeBuf_.get(), PAYLOAD_LENGTH_BYTES + length);
+    }
     transport_->flush();
+
+    // Same threshold as for the frames read, e.g. after a large add_partitions call
+    if (writeBufCapacity_ > MAX_RETAINED_BUF_SIZE) {
+        writeBuf_.reset();
+        writeBufCapacity_ = 0;
+    }
 }
 
 void TSaslTransport::sendSaslMessage(const NegotiationStatus status, const uint8_t* payload, const uint32_t length,
                                      bool flush) {
-    uint8_t messageHeader[STATUS_BYTES + PAYLOAD_LENGTH_BYTES];
-    uint8_t dummy = 0;
-    if (payload == nullptr) {
-        payload = &dummy;
+    // The negotiation completes before any data is written, so the write buffer is free.
+    // Header and payload are sent in a single write.
+    reserveWriteBuffer(HEADER_LENGTH + length);
+    uint8_t* message = writeBuf_.get();
+    message[0] = static_cast<uint8_t>(status);
+    encodeInt(length, message, STATUS_BYTES);
+    if (length > 0) {
+        memcpy(message + HEADER_LENGTH, payload, length);
     }
-    messageHeader[0] = static_cast<uint8_t>(status);
-    encodeInt(length, messageHeader, STATUS_BYTES);
-    transport_->write(messageHeader, HEADER_LENGTH);
-    transport_->write(payload, length);
+    transport_->write(message, HEADER_LENGTH + length);
     if (flush) {
         transport_->flush();
     }
@@ -262,9 +308,9 @@ uint8_t* TSaslTransport::receiveSaslMessage(NegotiationStatus* status, uint32_t*
     *length = decodeInt(messageHeader, STATUS_BYTES);
 
     // get payload
-    protoBuf_.reset(new uint8_t[*length]);
-    transport_->readAll(protoBuf_.get(), *length);
+    uint8_t* payload = reserveBuffer(protoBuf_, protoBufCapacity_, *length);
+    transport_->readAll(payload, *length);
 
-    return protoBuf_.get();
+    return payload;
 }
 } // namespace apache::thrift::transport
@@ -0,0 +1,267 @@
+#include "hive_metastore_client_pool.h"
+
+#include <sasl/sasl.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TSocket.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "TSasl.h"
+#include "TSaslClientTransport.h"
+
+using namespace apache::thrift;
+using namespace apache::thrift::transport;
+using namespace apache::thrift::protocol;
+
+using Clock = std::chrono::steady_clock;
+
+HiveMetastoreClientPool::Lease::~Lease() {
+    if (_connection) {
+        _pool->release(std::move(_connection), _broken);
+    }
+}
+
+HiveMetastoreClientPool::HiveMetastoreClientPool(HiveMetastoreClientPoolOptions options)
+        : _options(std::move(options)) {
+    if (!_options.principal.empty()) {
+        static std::once_flag sasl_init_flag;
+        std::call_once(sasl_init_flag, [] {
+            int result = sasl_client_init(nullptr);
+            if (result != SASL_OK) {
+                throw sasl::SaslException(sasl_errstring(result, nullptr, nullptr));
+            }
+        });
+        // service/fqdn@REALM
+        size_t slash_pos = _options.principal.find('/');
+        size_t at_pos = _options.principal.find('@');
+        _sasl_service = _options.principal.substr(0, slash_pos);
+        _sasl_fqdn = _options.principal.substr(slash_pos + 1, at_pos - slash_pos - 1);
+    }
+    {
+        // Warm up before lending anything, so that the first borrowers do not negotiate alongside the maintainer
+        std::unique_lock<std::mutex> lock(_mutex);
+        replenish(lock);
+    }
+    _maintainer = std::thread([this] { maintain(); });
+}
+
+HiveMetastoreClientPool::~HiveMetastoreClientPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _maintainer_wakeup.notify_all();
+    _maintainer.join();
+    for (auto& connection : _idle) {
+        close(*connection);
+    }
+}
+
+HiveMetastoreClientPool::Lease HiveMetastoreClientPool::borrow() {
+    const auto deadline = Clock::now() + _options.borrow_timeout;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        if (!_idle.empty()) {
+            // The most recently used connection is the least likely to have been closed by the server
+            std::unique_ptr<Connection> connection = std::move(_idle.back());
+            _idle.pop_back();
+            if (needs_replenish()) {
+                _maintainer_wakeup.notify_one();
+            }
+            lock.unlock();
+            if (is_usable(*connection)) {
+                return Lease(this, std::move(connection));
+            }
+            close(*connection);
+            lock.lock();
+            _size--;
+            if (needs_replenish()) {
+                _maintainer_wakeup.notify_one();
+            }
+            continue;
+        }
+        if (_size < _options.max_size) {
+            _size++;
+            lock.unlock();
+            try {
+                return Lease(this, connect());
+            } catch (...) {
+                lock.lock();
+                _size--;
+                _available.notify_one();
+                throw;
+            }
+        }
+        if (!_available.wait_until(lock, deadline, [this] { return !_idle.empty() || _size < _options.max_size; })) {
+            throw TTransportException(TTransportException::TIMED_OUT,
+                                      "No metastore connection available, all " + std::to_string(_size) +
+                                              " are borrowed");
+        }
+    }
+}
+
+size_t HiveMetastoreClientPool::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size;
+}
+
+size_t HiveMetastoreClientPool::idle_size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _idle.size();
+}
+
+std::unique_ptr<HiveMetastoreClientPool::Connection> HiveMetastoreClientPool::connect() {
+    try {
+        return negotiate();
+    } catch (const sasl::SaslException& e) {
+        if (!_options.refresh_credentials) {
+            throw;
+        }
+        std::cerr << "SASL negotiation failed, refreshing credentials: " << e.what() << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(_refresh_mutex);
+            _options.refresh_credentials();
+        }
+        return negotiate();
+    }
+}
+
+std::unique_ptr<HiveMetastoreClientPool::Connection> HiveMetastoreClientPool::negotiate() {
+    std::shared_ptr<TSocket> socket(new TSocket(_options.host, _options.port));
+    socket->setConnTimeout(_options.connect_timeout_ms);
+    socket->setRecvTimeout(_options.socket_timeout_ms);
+    socket->setSendTimeout(_options.socket_timeout_ms);
+    std::shared_ptr<TTransport> transport(new TBufferedTransport(socket));
+    if (!_options.principal.empty()) {
+        std::shared_ptr<sasl::TSasl> sasl(new sasl::TSaslClient("GSSAPI",    // mechanisms
+                                                                "",          // authenticationId
+                                                                _sasl_service,
+                                                                _sasl_fqdn,
+                                                                {},          // props
+                                                                nullptr      // callbacks
+                                                                ));
+        transport.reset(new TSaslClientTransport(sasl, transport));
+    }
+    // Opens the socket, then runs the SASL negotiation
+    transport->open();
+
+    auto connection = std::make_unique<Connection>();
+    connection->transport = transport;
+    connection->client = std::make_unique<Apache::Hadoop::Hive::ThriftHiveMetastoreClient>(
+            std::make_shared<TBinaryProtocol>(transport));
+    connection->created = connection->last_used = Clock::now();
+    return connection;
+}
+
+bool HiveMetastoreClientPool::is_usable(Connection& connection) {
+    const auto now = Clock::now();
+    if (now - connection.created > _options.max_lifetime || !connection.transport->isOpen()) {
+        return false;
+    }
+    if (now - connection.last_used < _options.validation_interval) {
+        return true;
+    }
+    // The server may have dropped the connection meanwhile, e.g. after its own idle timeout
+    try {
+        std::string value;
+        connection.client->getMetaConf(value, "hive.metastore.try.direct.sql");
+    } catch (const Apache::Hadoop::Hive::MetaException&) {
+        // The key is not readable on this metastore, it answered nonetheless
+    } catch (const TException& e) {
+        std::cerr << "Drop unhealthy metastore connection: " << e.what() << std::endl;
+        return false;
+    }
+    connection.last_used = Clock::now();
+    return true;
+}
+
+void HiveMetastoreClientPool::release(std::unique_ptr<Connection> connection, bool broken) {
+    if (!broken) {
+        connection->last_used = Clock::now();
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_stopping) {
+            _idle.push_back(std::move(connection));
+            _available.notify_one();
+            return;
+        }
+    }
+    close(*connection);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _size--;
+    _available.notify_one();
+    if (needs_replenish()) {
+        _maintainer_wakeup.notify_one();
+    }
+}
+
+void HiveMetastoreClientPool::close(Connection& connection) {
+    try {
+        connection.transport->close();
+    } catch (const TException& e) {
+        std::cerr << "Fail to close metastore connection: " << e.what() << std::endl;
+    }
+}
+
+bool HiveMetastoreClientPool::needs_replenish() const {
+    return !_stopping && _idle.size() < _options.min_idle && _size < _options.max_size;
+}
+
+bool HiveMetastoreClientPool::replenish(std::unique_lock<std::mutex>& lock) {
+    while (needs_replenish()) {
+        _size++;
+        lock.unlock();
+        std::unique_ptr<Connection> connection;
+        try {
+            connection = connect();
+        } catch (const TException& e) {
+            std::cerr << "Fail to connect to metastore: " << e.what() << std::endl;
+        }
+        lock.lock();
+        if (!connection) {
+            _size--;
+            _available.notify_one();
+            return false;
+        }
+        _idle.push_front(std::move(connection));
+        _available.notify_one();
+    }
+    return true;
+}
+
+void HiveMetastoreClientPool::maintain() {
+    const auto period = std::max(std::min(_options.idle_timeout, _options.max_lifetime) / 2,
+                                 std::chrono::milliseconds(100));
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stopping) {
+        // Evict the connections idle for too long or past their lifetime
+        std::vector<std::unique_ptr<Connection>> expired;
+        const auto now = Clock::now();
+        for (auto it = _idle.begin(); it != _idle.end();) {
+            if (now - (*it)->last_used > _options.idle_timeout || now - (*it)->created > _options.max_lifetime) {
+                expired.push_back(std::move(*it));
+                it = _idle.erase(it);
+            } else {
+                it++;
+            }
+        }
+        _size -= expired.size();
+        if (!expired.empty()) {
+            _available.notify_all();
+        }
+        lock.unlock();
+        for (auto& connection : expired) {
+            close(*connection);
+        }
+        lock.lock();
+
+        // Negotiate ahead of time the connections that the next borrowers will get. After a failure, wait for the
+        // next period instead of retrying on every wakeup
+        const bool failed = !replenish(lock);
+        _maintainer_wakeup.wait_for(lock, period,
+                                    [this, failed] { return _stopping || (!failed && needs_replenish()); });
+    }
+}
@@ -1,22 +1,16 @@
-#include <sasl/sasl.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/transport/TSocket.h>
-#include <thrift/transport/TTransportUtils.h>
-
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
-#include <memory>
-#include <utility>
+#include <string>
+#include <vector>
 
-#include "TSasl.h"
-#include "TSaslClientTransport.h"
 #include "ThriftHiveMetastore.h"
+#include "hive_metastore_client_pool.h"
 
 using namespace apache::thrift;
-using namespace apache::thrift::transport;
-using namespace apache::thrift::protocol;
 
 int main(int argc, char* argv[]) {
-    if (argc < 5) {
+    if (argc < 6) {
         std::cerr << "requires 5 arguments" << std::endl;
         return 1;
     }
@@ -25,15 +19,15 @@ int main(int argc, char* argv[]) {
     const std::string hms_principal = argv[3];
     const std::string db_name = argv[4];
     const std::string table_name = argv[5];
+    // Optional, to demonstrate how the pool recovers from an expired ticket
+    const std::string client_principal = argc > 7 ? argv[6] : "";
+    const std::string keytab = argc > 7 ? argv[7] : "";
 
     std::cout << "hms_ip: " << hms_ip << ", hms_port: " << hms_port << ", hms_principal: " << hms_principal
               << ", db_name: " << db_name << ", table_name: " << table_name << std::endl;
 
-    bool use_sasl = !hms_principal.empty();
-
-    auto execute = [](std::shared_ptr<TProtocol> protocol, const std::string& db_name, const std::string& table_name) {
-        Apache::Hadoop::Hive::ThriftHiveMetastoreClient client(std::move(protocol));
-
+    auto execute = [](Apache::Hadoop::Hive::ThriftHiveMetastoreClient& client, const std::string& db_name,
+                      const std::string& table_name) {
         // Fetch and print the list of databases
         std::vector<std::string> databases;
         client.get_all_databases(databases);
@@ -65,47 +59,52 @@ int main(int argc, char* argv[]) {
     };
 
     try {
-        if (use_sasl) {
-            int result = sasl_client_init(nullptr);
-            if (result != SASL_OK) {
-                std::cerr << "Failed to initialize SASL client library: " << sasl_errstring(result, nullptr, nullptr)
-                          << std::endl;
-                return 1;
+        HiveMetastoreClientPoolOptions options;
+        options.host = hms_ip;
+        options.port = hms_port;
+        // Empty to connect without SASL
+        options.principal = hms_principal;
+        if (!keytab.empty()) {
+            options.refresh_credentials = [&] {
+                const std::string command = "kinit -kt " + keytab + " " + client_principal;
+                std::cout << "refresh credentials: " << command << std::endl;
+                if (std::system(command.c_str()) != 0) {
+                    throw transport::TTransportException("Fail to run " + command);
+                }
+            };
+        }
+        HiveMetastoreClientPool pool(options);
+
+        pool.call([&](auto& client) { execute(client, db_name, table_name); });
+
+        // The connection, and its SASL negotiation, is reused: borrowing it again only takes a lock
+        for (int i = 0; i < 3; i++) {
+            auto start = std::chrono::steady_clock::now();
+            HiveMetastoreClientPool::Lease lease = pool.borrow();
+            auto borrowed = std::chrono::steady_clock::now();
+            std::vector<std::string> databases;
+            lease->get_all_databases(databases);
+            auto done = std::chrono::steady_clock::now();
+            std::cout << "borrow: " << std::chrono::duration_cast<std::chrono::microseconds>(borrowed - start).count()
+                      << "us, get_all_databases: "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(done - borrowed).count() << "us"
+                      << std::endl;
+        }
+        std::cout << "pool size: " << pool.size() << ", idle: " << pool.idle_size() << std::endl;
+
+        if (options.refresh_credentials) {
+            // Drop the ticket cache, as when the ticket expires. The established connections keep working, the next
+            // negotiation fails, refresh_credentials runs kinit and the negotiation is retried
+            std::system("kdestroy");
+            std::vector<HiveMetastoreClientPool::Lease> leases;
+            for (size_t i = 0, size = pool.size(); i <= size; i++) {
+                leases.push_back(pool.borrow());
             }
-
-            size_t slash_pos = hms_principal.find('/');
-            size_t at_pos = hms_principal.find('@');
-            const std::string service = hms_principal.substr(0, slash_pos);
-            const std::string server_fqdn = hms_principal.substr(slash_pos + 1, at_pos - slash_pos - 1);
-            std::cout << "service_name: " << service << ", hostname_fqdn: " << server_fqdn << std::endl;
-
-            std::shared_ptr<TTransport> socket(new TSocket(hms_ip, hms_port));
-            std::shared_ptr<TTransport> transport(new TBufferedTransport(socket));
-            std::shared_ptr<sasl::TSasl> sasl(new sasl::TSaslClient("GSSAPI",    // mechanisms
-                                                                    "",          // authenticationId
-                                                                    service,     // service
-                                                                    server_fqdn, // serverFQDN
-                                                                    {},          // props
-                                                                    nullptr      // callbacks
-                                                                    ));
-            std::shared_ptr<TSaslClientTransport> sasl_transport(new TSaslClientTransport(sasl, transport));
-            std::shared_ptr<TProtocol> protocol = std::make_shared<TBinaryProtocol>(sasl_transport);
-
-            transport->open();
-            sasl_transport->open();
-            execute(protocol, db_name, table_name);
-            sasl_transport->close();
-            transport->close();
-        } else {
-            std::shared_ptr<TTransport> socket(new TSocket(hms_ip, hms_port));
-            std::shared_ptr<TTransport> transport(new TBufferedTransport(socket));
-            std::shared_ptr<TProtocol> protocol = std::make_shared<TBinaryProtocol>(transport);
-
-            transport->open();
-            execute(protocol, db_name, table_name);
-            transport->close();
+            std::vector<std::string> databases;
+            leases.back()->get_all_databases(databases);
+            std::cout << "after the ticket expired, pool size: " << pool.size() << ", databases: " << databases.size()
+                      << std::endl;
         }
-
     } catch (TException& tx) {
         std::cerr << "Exception occurred: " << tx.what() << std::endl;
     }